@@ -1,124 +1,299 @@
-#pragma once
-
-#include <filesystem>
-#include <iostream>
-#include <tuple>
-
-#include "../player/content/content.hpp"
-#include "../player/pipeline/pipeline.hpp"
-#include "../player/window.hpp"
-
-namespace daia { namespace app {
-
-class App
-{
-public:
-  App(std::filesystem::path appPath)
-  {
-    _appRoot = appPath.parent_path();
-  }
-
-  void run(const std::vector<std::filesystem::path>& filePath)
-  {
-    _setup(filePath);
-
-    while (!_window.shouldClose())
-    {
-      _update();
-      _draw();
-    }
-
-    _exit();
-  }
-
-private:
-  std::string _appName = "daia";
-  uint32_t _width = 1024;
-  uint32_t _height = 512;
-
-  std::filesystem::path _appRoot;
-
-  player::Window _window;
-  player::pipeline::Pipeline _pipeline;
-
-  std::chrono::steady_clock::time_point _startTime = std::chrono::steady_clock::now();
-
-  void _setup(const std::vector<std::filesystem::path>& filePaths)
-  {
-    // set app name, width, height
-
-    _setupWindow();
-    _setupPipeline(_window.getRequiredInstanceExtensions());
-
-    if (filePaths.empty())
-    {
-      _pipeline.registerContent("default", std::make_shared<player::content::EmptyContent>(_width, _height));
-    }
-    else
-    {
-      for (const auto& path : filePaths)
-      {
-        _pipeline.registerContent(path.string(), std::make_shared<player::content::VideoContent>(path));
-      }
-    }
-  }
-
-  void _setupWindow()
-  {
-    _window = player::Window();
-
-    auto setupInfo = player::Window::SetupInfo{
-      .width = _width,
-      .height = _height,
-      .title = _appName,
-      .icons = {
-        daia::util::fromFile(_appRoot / "icon.png"),
-      },
-      .position = std::make_tuple(-1500, 800),
-    };
-
-    if (!_window.setup(setupInfo))
-    {
-      std::cout << "failed to setup main window" << std::endl;
-    }
-  }
-
-  void _setupPipeline(const std::vector<const char*>& extensions)
-  {
-    auto info = player::pipeline::SetupArgs{
-      .appRoot = _appRoot,
-      .appName = _appName,
-      .width = _width,
-      .height = _height,
-      .instanceExtensions = extensions,
-      .enableValidationLayers = true,
-      .window = _window,
-    };
-
-    if (!_pipeline.setup(info))
-    {
-      util::println("failed to setup pipeline");
-    }
-  }
-
-  void _update()
-  {
-    _window.poll();
-    const auto globalTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime).count() / 1000.0f;
-    _pipeline.update(globalTime);
-  }
-
-  void _draw()
-  {
-    _pipeline.draw();
-  }
-
-  void _exit()
-  {
-    _pipeline.destroy();
-    _window.close();
-    player::Window::terminate();
-  }
-};
-
-}} // namespace daia::app
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <tuple>
+
+#include "../player/content/content.hpp"
+#include "../player/pipeline/pipeline.hpp"
+#include "../player/window.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/trace.hpp"
+
+namespace daia { namespace app {
+
+struct Options
+{
+  bool hashTiles = false;
+  bool mipmaps = false;                 // mipmapped content textures for panes smaller than their content
+  bool releaseHidden = false;           // contents no pane shows free their decode buffers
+  uint32_t decodeThreads = 0;           // decoding threads shared by all shown videos, the decode scheduler's included. 0 uses one per core
+  uint32_t readAheadMiB = 16;           // file data read ahead of each demuxer. 0 reads through libavformat
+  bool headless = false;                // render offscreen without a window, at a fixed time step so frame dumps are reproducible
+  int64_t frames = 0;                   // frames to render before exiting. 0 runs until the window is closed
+  std::vector<int64_t> dumpFrames;      // frame numbers saved as images
+  std::filesystem::path dumpDirectory = ".";
+  std::filesystem::path traceFile = "daia_trace.json"; // written on exit when built with DAIA_ENABLE_TRACE
+  player::pipeline::PresentPolicy presentPolicy = player::pipeline::PresentPolicy::eTearFree;
+};
+
+class App
+{
+public:
+  // opening is mostly waiting on file io, so more threads than cores still help
+  static constexpr size_t openThreadCount = 8;
+  static constexpr double headlessFrameRate = 60;
+
+  App(std::filesystem::path appPath, Options options)
+  {
+    _appRoot = appPath.parent_path();
+    _options = options;
+  }
+
+  void run(const std::vector<std::filesystem::path>& filePath)
+  {
+    _setup(filePath);
+    _setupMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _startTime).count();
+
+    const auto start = std::chrono::steady_clock::now();
+    int64_t frame = 0;
+    player::pipeline::FrameStats stats;
+    uint64_t statsFrames = 0;
+    while (_options.headless || !_window.shouldClose())
+    {
+      if (_options.frames > 0 && frame >= _options.frames)
+      {
+        break;
+      }
+
+      _update(frame);
+
+      const auto dump = std::find(_options.dumpFrames.begin(), _options.dumpFrames.end(), frame) != _options.dumpFrames.end();
+      if (dump)
+      {
+        _pipeline.requestCapture();
+      }
+      _draw();
+      if (frame == 0)
+      {
+        const auto firstFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _startTime).count();
+        util::println("time to first frame: {:.1f} ms (setup {:.1f} ms)", firstFrame, _setupMilliseconds);
+      }
+      if (dump)
+      {
+        _dump(frame);
+      }
+      frame++;
+
+      // stats lag behind by the frames in flight. count every finished frame once
+      if (const auto& s = _pipeline.stats(); s.frame > stats.frame)
+      {
+        stats += s;
+        statsFrames++;
+      }
+    }
+
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    util::println("{} frames in {:.3f} s ({:.1f} fps)", frame, seconds, frame / seconds);
+    _printStats(stats, statsFrames);
+    _printReadAheadStats();
+
+    _exit();
+  }
+
+private:
+  std::string _appName = "daia";
+  uint32_t _width = 1024;
+  uint32_t _height = 512;
+
+  std::filesystem::path _appRoot;
+  Options _options;
+
+  player::Window _window;
+  player::pipeline::Pipeline _pipeline;
+  util::ThreadPool _openPool{ openThreadCount, "open" };
+  std::vector<std::shared_ptr<player::content::VideoContent>> _videos;
+
+  std::chrono::steady_clock::time_point _startTime = std::chrono::steady_clock::now();
+  double _setupMilliseconds = 0;
+
+  void _setup(const std::vector<std::filesystem::path>& filePaths)
+  {
+    // set app name, width, height
+
+    if (_options.headless)
+    {
+      _setupPipeline({});
+    }
+    else
+    {
+      _setupWindow();
+      _setupPipeline(_window.getRequiredInstanceExtensions());
+    }
+
+    if (filePaths.empty())
+    {
+      _pipeline.registerContent("default", std::make_shared<player::content::EmptyContent>(_width, _height));
+    }
+    else
+    {
+      // files are opened and indexed on the pool. panes show a placeholder until then, so the window comes up right away
+      for (const auto& path : filePaths)
+      {
+        const auto readAhead = player::media::ReadAheadOptions{ .window = size_t(_options.readAheadMiB) << 20 };
+        auto content = std::make_shared<player::content::VideoContent>(path, readAhead);
+        if (_pipeline.registerContent(path.string(), content))
+        {
+          _videos.push_back(content);
+          _openPool.submit([content] { content->open(); });
+        }
+      }
+
+      // frame dumps of headless runs must not depend on how fast the files open
+      if (_options.headless)
+      {
+        _openPool.wait();
+      }
+    }
+  }
+
+  void _setupWindow()
+  {
+    _window = player::Window();
+
+    auto setupInfo = player::Window::SetupInfo{
+      .width = _width,
+      .height = _height,
+      .title = _appName,
+      .icons = {
+        daia::util::fromFile(_appRoot / "icon.png"),
+      },
+      .position = std::make_tuple(-1500, 800),
+    };
+
+    if (!_window.setup(setupInfo))
+    {
+      std::cout << "failed to setup main window" << std::endl;
+    }
+  }
+
+  void _setupPipeline(const std::vector<const char*>& extensions)
+  {
+    auto info = player::pipeline::SetupArgs{
+      .appRoot = _appRoot,
+      .appName = _appName,
+      .width = _width,
+      .height = _height,
+      .instanceExtensions = extensions,
+      .enableValidationLayers = !_options.headless,
+      .window = _options.headless ? nullptr : &_window,
+      .hashTiles = _options.hashTiles,
+      .waitForFrames = _options.headless,
+      .mipmaps = _options.mipmaps,
+      .releaseHiddenContents = _options.releaseHidden,
+      .decodeThreadBudget = _options.decodeThreads,
+      .presentPolicy = _options.presentPolicy,
+      .pipelineCachePath = util::userCacheDirectory(_appName) / "pipeline_cache.bin",
+    };
+
+    if (!_pipeline.setup(info))
+    {
+      util::println("failed to setup pipeline");
+    }
+  }
+
+  void _update(int64_t frame)
+  {
+    DAIA_TRACE_SCOPE("App::_update");
+    if (!_options.headless)
+    {
+      _window.poll();
+    }
+    // headless time advances one step per frame and contents wait for their frames, so two runs show the same frames
+    const auto globalTime = _options.headless
+      ? frame / headlessFrameRate
+      : std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+    _pipeline.update(globalTime);
+  }
+
+  void _draw()
+  {
+    DAIA_TRACE_SCOPE("App::_draw");
+    _pipeline.draw();
+  }
+
+  void _printStats(const player::pipeline::FrameStats& total, uint64_t frames)
+  {
+    if (frames == 0)
+    {
+      return;
+    }
+    const auto n = static_cast<double>(frames);
+    util::println(
+      "cpu ms/frame: fence {:.3f} update {:.3f} write {:.3f} upload {:.3f} acquire {:.3f} record {:.3f} present {:.3f}",
+      total.fenceWait / n,
+      total.contentUpdate / n,
+      total.stagingWrite / n,
+      total.uploadRecord / n,
+      total.acquire / n,
+      total.drawRecord / n,
+      total.present / n);
+    util::println(
+      "gpu ms/frame: upload {:.3f} render {:.3f} | {:.1f} copies, {:.1f} KiB uploaded per frame",
+      total.gpuUpload / n,
+      total.gpuRender / n,
+      total.uploadCopies / n,
+      total.uploadBytes / n / 1024);
+  }
+
+  void _printReadAheadStats()
+  {
+    player::media::ReadAheadStats total;
+    for (const auto& video : _videos)
+    {
+      const auto stats = video->readAheadStats();
+      total.bytesRead += stats.bytesRead;
+      total.readSeconds += stats.readSeconds;
+      total.stallSeconds += stats.stallSeconds;
+      total.stalls += stats.stalls;
+    }
+    if (total.bytesRead == 0)
+    {
+      return;
+    }
+    util::println(
+      "read-ahead: {:.1f} MiB at {:.1f} MiB/s, demuxers stalled {} times for {:.1f} ms",
+      total.bytesRead / 1048576.0,
+      total.bytesPerSecond() / 1048576.0,
+      total.stalls,
+      total.stallSeconds * 1000);
+  }
+
+  void _dump(int64_t frame)
+  {
+    const auto image = _pipeline.takeCapture();
+    if (!image)
+    {
+      util::println("frame {} was not captured. frame dumps need --headless", frame);
+      return;
+    }
+    const auto path = _options.dumpDirectory / util::format("frame_{:06}.ppm", frame);
+    if (!image->savePpm(path))
+    {
+      util::println("failed to write {}", path.string());
+    }
+  }
+
+  void _exit()
+  {
+    // destroying the contents first cancels the opens in progress, so stopping the pool does not wait for them
+    _pipeline.unregisterAllContents();
+    _openPool.stop();
+    _videos.clear();
+    _pipeline.destroy();
+    if (util::trace::enabled && !util::trace::write(_options.traceFile))
+    {
+      util::println("failed to write {}", _options.traceFile.string());
+    }
+    if (!_options.headless)
+    {
+      _window.close();
+      player::Window::terminate();
+    }
+  }
+};
+
+}} // namespace daia::app
@@ -1,37 +1,65 @@
-#include <CLI/CLI.hpp>
-#include <iostream>
-
-#include "app.hpp"
-
-int main(int argc, char* argv[])
-{
-  if (argc == 0)
-  {
-    return -1;
-  }
-  auto appPath = argv[0];
-
-  CLI::App args{ "daia" };
-  argv = args.ensure_utf8(argv);
-
-  std::vector<std::filesystem::path> filePaths;
-  args.add_option("file-paths", filePaths, "file paths");
-
-  CLI11_PARSE(args, argc, argv);
-
-  try
-  {
-    auto app = daia::app::App(appPath);
-    app.run(filePaths);
-  } catch (const vk::SystemError& e)
-  {
-    std::cout << "vk::SystemError: " << e.what() << std::endl;
-    return -1;
-  } catch (const std::exception& e)
-  {
-    std::cerr << e.what() << std::endl;
-    return -1;
-  }
-
-  return 0;
-}
+#include <CLI/CLI.hpp>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "app.hpp"
+
+int main(int argc, char* argv[])
+{
+  if (argc == 0)
+  {
+    return -1;
+  }
+  auto appPath = argv[0];
+
+  CLI::App args{ "daia" };
+  argv = args.ensure_utf8(argv);
+
+  std::vector<std::filesystem::path> filePaths;
+  args.add_option("file-paths", filePaths, "file paths");
+
+  daia::app::Options options;
+  args.add_flag("--hash-tiles", options.hashTiles, "skip uploading tiles that did not change since the last frame");
+  args.add_flag("--mipmaps", options.mipmaps, "build mip chains of content textures on the GPU after each upload. smoother in panes smaller than their content");
+  args.add_flag("--release-hidden", options.releaseHidden, "free the decode buffers of contents no pane shows");
+  args.add_option("--decode-threads", options.decodeThreads, "decoding threads shared by all shown videos, split by resolution and codec. the decode workers count against it. 0 uses one per core");
+  args.add_option("--read-ahead-mib", options.readAheadMiB, "MiB of each file read ahead of its demuxer on background threads. 0 reads through libavformat");
+  args.add_flag("--headless", options.headless, "render offscreen without a window at a fixed 60 fps time step. frame dumps are reproducible");
+  args.add_option("--frames", options.frames, "number of frames to render. 0 runs until the window is closed, headless runs default to 600");
+  args.add_option("--dump-frame", options.dumpFrames, "frame numbers to save as PPM images (headless only)");
+  args.add_option("--dump-dir", options.dumpDirectory, "directory for dumped frames");
+  args.add_option("--trace-file", options.traceFile, "Chrome trace output. needs a build with DAIA_ENABLE_TRACE");
+
+  using daia::player::pipeline::PresentPolicy;
+  const std::map<std::string, PresentPolicy> presentPolicies = {
+    { "fifo", PresentPolicy::eTearFree },
+    { "mailbox", PresentPolicy::eLowLatency },
+    { "immediate", PresentPolicy::eUncapped },
+  };
+  args.add_option("--present-mode", options.presentPolicy, "fifo: tear-free, mailbox: low latency, immediate: uncapped for benchmarks. falls back to fifo when unsupported")
+    ->transform(CLI::CheckedTransformer(presentPolicies, CLI::ignore_case));
+
+  CLI11_PARSE(args, argc, argv);
+
+  if (options.headless && options.frames == 0)
+  {
+    options.frames = 600;
+  }
+
+  try
+  {
+    auto app = daia::app::App(appPath, options);
+    app.run(filePaths);
+  } catch (const vk::SystemError& e)
+  {
+    std::cout << "vk::SystemError: " << e.what() << std::endl;
+    return -1;
+  } catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+// Counts heap allocations of the whole process.
+// Include from exactly one translation unit: it replaces the global operator new
+// and, on glibc, interposes malloc & co. so allocations inside FFmpeg are counted too.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace daia { namespace bench {
+
+struct AllocationCount
+{
+  uint64_t cpp = 0; // operator new
+  uint64_t c = 0;   // malloc family (FFmpeg, libc)
+
+  uint64_t total() const
+  {
+    return cpp + c;
+  }
+
+  AllocationCount operator-(const AllocationCount& rhs) const
+  {
+    return { .cpp = cpp - rhs.cpp, .c = c - rhs.c };
+  }
+};
+
+inline std::atomic<uint64_t> cppAllocations = 0;
+inline std::atomic<uint64_t> cAllocations = 0;
+
+inline AllocationCount allocations()
+{
+  return {
+    .cpp = cppAllocations.load(std::memory_order_relaxed),
+    .c = cAllocations.load(std::memory_order_relaxed),
+  };
+}
+
+}} // namespace daia::bench
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+  daia::bench::cAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+  daia::bench::cAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+  daia::bench::cAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+  daia::bench::cAllocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = __libc_memalign(alignment, size);
+  if (p == nullptr)
+  {
+    return ENOMEM;
+  }
+  *ptr = p;
+  return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+  daia::bench::cAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+}
+
+inline void* countedNew(size_t size)
+{
+  daia::bench::cppAllocations.fetch_add(1, std::memory_order_relaxed);
+  // bypass the counting malloc above
+  if (void* p = __libc_malloc(size == 0 ? 1 : size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+inline void countedDelete(void* ptr) noexcept
+{
+  __libc_free(ptr);
+}
+#else
+inline void* countedNew(size_t size)
+{
+  daia::bench::cppAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+inline void countedDelete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+#endif
+
+void* operator new(size_t size)
+{
+  return countedNew(size);
+}
+
+void* operator new[](size_t size)
+{
+  return countedNew(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  countedDelete(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  countedDelete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  countedDelete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+  countedDelete(ptr);
+}
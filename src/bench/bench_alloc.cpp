@@ -0,0 +1,147 @@
+#include <CLI/CLI.hpp>
+#include <thread>
+
+#include "alloc_counter.hpp"
+
+#include "../player/media/video.hpp"
+#include "../player/media/video_decoder.hpp"
+#include "../util/util.hpp"
+
+using namespace daia;
+
+namespace {
+
+// false when the counted frames allocated: steady-state decoding is meant to reuse every buffer
+bool report(std::string_view name, const bench::AllocationCount& count, int64_t frames)
+{
+  util::println(
+    "{}: {} frames, {} allocations (operator new {}, malloc {}), {:.2f} per frame",
+    name,
+    frames,
+    count.total(),
+    count.cpp,
+    count.c,
+    frames > 0 ? static_cast<double>(count.total()) / frames : 0.0);
+  if (count.total() > 0)
+  {
+    util::println("{}: steady-state decoding allocated", name);
+    return false;
+  }
+  return true;
+}
+
+enum class Result
+{
+  eOk,
+  eFailedToOpen,
+  eAllocated,
+};
+
+// Video::getFrame() into a caller owned buffer on the calling thread
+Result benchVideo(const std::filesystem::path& path, int64_t warmup, int64_t frames)
+{
+  player::media::Video video;
+  if (!video.setup(path))
+  {
+    return Result::eFailedToOpen;
+  }
+
+  frames = std::clamp<int64_t>(video.frameCount() - warmup, 0, frames);
+  std::vector<uint8_t> buffer(video.outputLayout().size);
+
+  for (int64_t i = 0; i < warmup; i++)
+  {
+    video.getFrame(i, buffer);
+  }
+
+  const auto before = bench::allocations();
+  for (int64_t i = warmup; i < warmup + frames; i++)
+  {
+    video.getFrame(i, buffer);
+  }
+  const auto allocationFree = report("Video::getFrame", bench::allocations() - before, frames);
+
+  video.destroy();
+  return allocationFree ? Result::eOk : Result::eAllocated;
+}
+
+// VideoDecoder steps on the shared decode scheduler, consumed the same way VideoContent::update() does
+Result benchDecoder(const std::filesystem::path& path, int64_t warmup, int64_t frames)
+{
+  player::media::VideoDecoder decoder;
+  if (!decoder.setup(path))
+  {
+    return Result::eFailedToOpen;
+  }
+
+  frames = std::clamp<int64_t>(decoder.frameCount() - warmup, 0, frames);
+  player::media::DecodedFrame current;
+  // stands in for the staging memory the pipeline hands to write()
+  std::vector<uint8_t> staging(decoder.outputLayout().size);
+
+  auto consume = [&](int64_t count) {
+    for (int64_t i = 0; i < count && !decoder.finished();)
+    {
+      if (auto frame = decoder.tryPop())
+      {
+        decoder.recycle(std::move(current));
+        current = std::move(*frame);
+        decoder.write(current, staging);
+        i++;
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  decoder.start();
+  consume(warmup);
+
+  const auto before = bench::allocations();
+  consume(frames);
+  const auto allocationFree = report("VideoDecoder", bench::allocations() - before, frames);
+
+  decoder.destroy();
+  return allocationFree ? Result::eOk : Result::eAllocated;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  CLI::App args{ "daia_bench_alloc" };
+  argv = args.ensure_utf8(argv);
+
+  std::filesystem::path filePath;
+  int64_t warmup = 30;
+  int64_t frames = 300;
+  args.add_option("file-path", filePath, "video file")->required();
+  args.add_option("--warmup", warmup, "frames decoded before counting");
+  args.add_option("--frames", frames, "frames counted");
+
+  CLI11_PARSE(args, argc, argv);
+
+  const auto video = benchVideo(filePath, warmup, frames);
+  if (video == Result::eFailedToOpen)
+  {
+    util::println("failed to open {}", filePath.string());
+    return -1;
+  }
+  // the decoder runs even if the first pass allocated, so one run reports both paths
+  const auto decoder = benchDecoder(filePath, warmup, frames);
+  if (decoder == Result::eFailedToOpen)
+  {
+    util::println("failed to open {}", filePath.string());
+    return -1;
+  }
+
+  // non-zero when a steady-state frame allocated, so the benchmark can gate changes
+  if (video == Result::eAllocated || decoder == Result::eAllocated)
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,294 @@
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <optional>
+
+#include "alloc_counter.hpp"
+#include "synthetic_clip.hpp"
+
+#include "../player/media/video.hpp"
+#include "../util/util.hpp"
+
+using namespace daia;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+  int threads = 1;
+  std::optional<player::common::PixelFormat> format; // nullopt keeps the format Video picks for the file
+  int64_t frames = 300;
+  int64_t convertFrames = 16; // decoded frames kept in memory for the convert-only pass
+};
+
+// per-frame times of one pass
+class Samples
+{
+public:
+  explicit Samples(size_t capacity)
+  {
+    _ms.reserve(capacity);
+  }
+
+  void add(Clock::duration d)
+  {
+    _ms.push_back(std::chrono::duration<double, std::milli>(d).count());
+  }
+
+  size_t size() const
+  {
+    return _ms.size();
+  }
+
+  double total() const
+  {
+    return std::accumulate(_ms.begin(), _ms.end(), 0.0);
+  }
+
+  double percentile(double p)
+  {
+    if (_ms.empty())
+    {
+      return 0;
+    }
+    std::sort(_ms.begin(), _ms.end());
+    return _ms[std::min(_ms.size() - 1, static_cast<size_t>(p / 100 * _ms.size()))];
+  }
+
+private:
+  std::vector<double> _ms;
+};
+
+void report(std::string_view name, Samples& samples, const bench::AllocationCount& count)
+{
+  const auto frames = samples.size();
+  const auto seconds = samples.total() / 1000;
+  util::println(
+    "{:<8} {:>6} frames {:>9.1f} fps | ms p50 {:.3f} p90 {:.3f} p99 {:.3f} max {:.3f} | {:.2f} allocs/frame",
+    name,
+    frames,
+    seconds > 0 ? frames / seconds : 0.0,
+    samples.percentile(50),
+    samples.percentile(90),
+    samples.percentile(99),
+    samples.percentile(100),
+    frames > 0 ? static_cast<double>(count.total()) / frames : 0.0);
+}
+
+bool open(player::media::Video& video, const std::filesystem::path& path, const Options& options)
+{
+  if (!video.setup(path, options.threads))
+  {
+    return false;
+  }
+  if (options.format)
+  {
+    video.setOutputFormat(*options.format);
+  }
+  return true;
+}
+
+// demux + decode until a frame comes out. false at the end of the stream
+bool decodeNext(player::media::Video& video, AVPacket* packet, AVFrame* frame, bool& draining)
+{
+  while (true)
+  {
+    const auto ret = video.receiveFrame(frame);
+    if (ret == 0)
+    {
+      return true;
+    }
+    if (ret != AVERROR(EAGAIN))
+    {
+      return false;
+    }
+
+    if (video.readPacket(packet))
+    {
+      video.sendPacket(packet);
+      av_packet_unref(packet);
+    }
+    else if (!draining)
+    {
+      video.sendPacket(nullptr);
+      draining = true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+}
+
+// Video::readPacket/sendPacket/receiveFrame only
+bool benchDecode(const std::filesystem::path& path, const Options& options)
+{
+  player::media::Video video;
+  if (!open(video, path, options))
+  {
+    return false;
+  }
+
+  auto packet = player::media::makePacket();
+  auto frame = player::media::makeFrame();
+  auto draining = false;
+  Samples samples(options.frames);
+
+  const auto before = bench::allocations();
+  for (int64_t i = 0; i < options.frames; i++)
+  {
+    const auto start = Clock::now();
+    if (!decodeNext(video, packet.get(), frame.get(), draining))
+    {
+      break;
+    }
+    av_frame_unref(frame.get());
+    samples.add(Clock::now() - start);
+  }
+  report("decode", samples, bench::allocations() - before);
+
+  video.destroy();
+  return true;
+}
+
+// Video::convert over decoded frames kept in memory, so decoding is not measured
+bool benchConvert(const std::filesystem::path& path, const Options& options)
+{
+  player::media::Video video;
+  if (!open(video, path, options))
+  {
+    return false;
+  }
+
+  auto packet = player::media::makePacket();
+  auto draining = false;
+  std::vector<player::media::Frame> decoded;
+  while (decoded.size() < static_cast<size_t>(options.convertFrames))
+  {
+    auto frame = player::media::makeFrame();
+    if (!decodeNext(video, packet.get(), frame.get(), draining))
+    {
+      break;
+    }
+    decoded.push_back(std::move(frame));
+  }
+  if (decoded.empty())
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> buffer(video.outputLayout().size);
+  Samples samples(options.frames);
+
+  // the first call creates the scaler
+  video.convert(decoded.front().get(), buffer.data());
+
+  const auto before = bench::allocations();
+  for (int64_t i = 0; i < options.frames; i++)
+  {
+    const auto start = Clock::now();
+    video.convert(decoded[i % decoded.size()].get(), buffer.data());
+    samples.add(Clock::now() - start);
+  }
+  report("convert", samples, bench::allocations() - before);
+
+  decoded.clear();
+  video.destroy();
+  return true;
+}
+
+// decode and convert of every frame on one thread, as Video::getFrame does sequentially
+bool benchEndToEnd(const std::filesystem::path& path, const Options& options)
+{
+  player::media::Video video;
+  if (!open(video, path, options))
+  {
+    return false;
+  }
+
+  auto packet = player::media::makePacket();
+  auto frame = player::media::makeFrame();
+  auto draining = false;
+  std::vector<uint8_t> buffer(video.outputLayout().size);
+  Samples samples(options.frames);
+
+  const auto before = bench::allocations();
+  for (int64_t i = 0; i < options.frames; i++)
+  {
+    const auto start = Clock::now();
+    if (!decodeNext(video, packet.get(), frame.get(), draining))
+    {
+      break;
+    }
+    video.convert(frame.get(), buffer.data());
+    av_frame_unref(frame.get());
+    samples.add(Clock::now() - start);
+  }
+  report("e2e", samples, bench::allocations() - before);
+
+  video.destroy();
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  CLI::App args{ "daia_bench_decode" };
+  argv = args.ensure_utf8(argv);
+
+  std::filesystem::path filePath;
+  Options options;
+  std::string format = "auto";
+  auto clip = bench::SyntheticClip{};
+  args.add_option("file-path", filePath, "video file. a synthetic clip is generated when omitted");
+  args.add_option("--threads", options.threads, "decoder threads. 0 picks one per core");
+  args.add_option("--format", format, "output format")->check(CLI::IsMember({ "auto", "rgba", "yuv420p", "nv12" }));
+  args.add_option("--frames", options.frames, "frames measured per pass");
+  args.add_option("--convert-frames", options.convertFrames, "decoded frames reused by the convert pass")->check(CLI::PositiveNumber);
+  args.add_option("--width", clip.width, "synthetic clip width");
+  args.add_option("--height", clip.height, "synthetic clip height");
+  args.add_option("--clip-frames", clip.frames, "synthetic clip length");
+
+  CLI11_PARSE(args, argc, argv);
+
+  const std::map<std::string, player::common::PixelFormat> formats = {
+    { "rgba", player::common::PixelFormat::eRGBA8 },
+    { "yuv420p", player::common::PixelFormat::eYUV420P },
+    { "nv12", player::common::PixelFormat::eNV12 },
+  };
+  if (const auto it = formats.find(format); it != formats.end())
+  {
+    options.format = it->second;
+  }
+
+  auto synthetic = false;
+  if (filePath.empty())
+  {
+    filePath = std::filesystem::temp_directory_path() / util::format("daia_bench_{}x{}_{}.mp4", clip.width, clip.height, clip.frames);
+    if (!bench::writeSyntheticClip(filePath, clip))
+    {
+      return -1;
+    }
+    synthetic = true;
+  }
+
+  util::println("{}: threads {}, format {}", filePath.string(), options.threads, format);
+  const auto ok = benchDecode(filePath, options) && benchConvert(filePath, options) && benchEndToEnd(filePath, options);
+
+  if (synthetic)
+  {
+    std::filesystem::remove(filePath);
+  }
+  if (!ok)
+  {
+    util::println("failed to open {}", filePath.string());
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+#include "../player/media/ffmpeg.hpp"
+
+namespace daia { namespace bench {
+
+struct SyntheticClip
+{
+  int width = 1280;
+  int height = 720;
+  int frames = 300;
+  int fps = 30;
+};
+
+namespace detail {
+
+inline bool writePackets(AVCodecContext* encoder, AVFormatContext* output, AVStream* stream, AVPacket* packet)
+{
+  while (true)
+  {
+    const auto ret = avcodec_receive_packet(encoder, packet);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+    {
+      return true;
+    }
+    if (ret < 0)
+    {
+      return false;
+    }
+    av_packet_rescale_ts(packet, encoder->time_base, stream->time_base);
+    packet->stream_index = stream->index;
+    if (av_interleaved_write_frame(output, packet) < 0)
+    {
+      return false;
+    }
+  }
+}
+
+} // namespace detail
+
+// Encodes a moving gradient with the built-in MPEG-4 part 2 encoder, so no media has to be checked in.
+// Bit-exact flags and a single encoder thread make the file the same on every run.
+// B-frames are enabled so decoding reorders frames like real footage does.
+inline bool writeSyntheticClip(const std::filesystem::path& path, const SyntheticClip& clip)
+{
+  const auto codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+  if (!codec)
+  {
+    fprintf(stderr, "MPEG-4 encoder not available\n");
+    return false;
+  }
+
+  AVFormatContext* oc = nullptr;
+  if (avformat_alloc_output_context2(&oc, nullptr, nullptr, reinterpret_cast<const char*>(path.u8string().c_str())) < 0)
+  {
+    fprintf(stderr, "Could not create output context\n");
+    return false;
+  }
+  const auto output = std::unique_ptr<AVFormatContext, decltype(&avformat_free_context)>(oc, &avformat_free_context);
+  output->flags |= AVFMT_FLAG_BITEXACT;
+
+  const auto encoder = player::media::CodecContext(avcodec_alloc_context3(codec));
+  encoder->width = clip.width;
+  encoder->height = clip.height;
+  encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+  encoder->time_base = AVRational{ 1, clip.fps };
+  encoder->framerate = AVRational{ clip.fps, 1 };
+  encoder->gop_size = 30;
+  encoder->max_b_frames = 2;
+  encoder->bit_rate = int64_t(clip.width) * clip.height * clip.fps / 4;
+  encoder->thread_count = 1;
+  encoder->flags |= AV_CODEC_FLAG_BITEXACT;
+  if (output->oformat->flags & AVFMT_GLOBALHEADER)
+  {
+    encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  if (avcodec_open2(encoder.get(), codec, nullptr) < 0)
+  {
+    fprintf(stderr, "Failed to open encoder\n");
+    return false;
+  }
+
+  const auto stream = avformat_new_stream(output.get(), nullptr);
+  stream->time_base = encoder->time_base;
+  avcodec_parameters_from_context(stream->codecpar, encoder.get());
+
+  if (avio_open(&output->pb, reinterpret_cast<const char*>(path.u8string().c_str()), AVIO_FLAG_WRITE) < 0)
+  {
+    fprintf(stderr, "Could not open %s\n", path.string().c_str());
+    return false;
+  }
+  if (avformat_write_header(output.get(), nullptr) < 0)
+  {
+    avio_closep(&output->pb);
+    return false;
+  }
+
+  auto frame = player::media::makeFrame();
+  frame->format = encoder->pix_fmt;
+  frame->width = clip.width;
+  frame->height = clip.height;
+  av_frame_get_buffer(frame.get(), 0);
+  auto packet = player::media::makePacket();
+
+  auto ok = true;
+  for (int i = 0; i < clip.frames && ok; i++)
+  {
+    av_frame_make_writable(frame.get());
+    for (int y = 0; y < clip.height; y++)
+    {
+      auto* row = frame->data[0] + y * frame->linesize[0];
+      for (int x = 0; x < clip.width; x++)
+      {
+        row[x] = static_cast<uint8_t>(x + y * 2 + i * 3);
+      }
+    }
+    for (int plane = 1; plane < 3; plane++)
+    {
+      for (int y = 0; y < (clip.height + 1) / 2; y++)
+      {
+        auto* row = frame->data[plane] + y * frame->linesize[plane];
+        for (int x = 0; x < (clip.width + 1) / 2; x++)
+        {
+          row[x] = static_cast<uint8_t>(plane == 1 ? 128 + y + i * 2 : 64 + x + i * 5);
+        }
+      }
+    }
+    frame->pts = i;
+
+    ok = avcodec_send_frame(encoder.get(), frame.get()) >= 0 && detail::writePackets(encoder.get(), output.get(), stream, packet.get());
+  }
+
+  // flush the frames held back for B-frames
+  ok = ok && avcodec_send_frame(encoder.get(), nullptr) >= 0 && detail::writePackets(encoder.get(), output.get(), stream, packet.get());
+  ok = ok && av_write_trailer(output.get()) >= 0;
+  avio_closep(&output->pb);
+
+  if (!ok)
+  {
+    fprintf(stderr, "Failed to encode %s\n", path.string().c_str());
+  }
+  return ok;
+}
+
+}} // namespace daia::bench
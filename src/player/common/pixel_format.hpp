@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace daia { namespace player { namespace common {
+
+// values are shared with pane.frag
+enum class PixelFormat : uint32_t
+{
+  eRGBA8 = 0,
+  eYUV420P = 1, // Y, U, V planes. chroma is half size in both directions
+  eNV12 = 2,    // Y plane + interleaved UV plane
+};
+
+enum class ColorMatrix : uint32_t
+{
+  eBT601 = 0,
+  eBT709 = 1,
+};
+
+struct ColorSpace
+{
+  ColorMatrix matrix = ColorMatrix::eBT709;
+  bool fullRange = false;
+};
+
+inline constexpr uint32_t maxPlaneCount = 3;
+
+// rectangle in pixels of the first plane
+struct Region
+{
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+struct Plane
+{
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytesPerPixel = 0;
+  uint32_t subsampling = 0; // log2 of the size ratio to the first plane
+  size_t offset = 0;
+
+  size_t rowPitch() const
+  {
+    return width * bytesPerPixel;
+  }
+
+  size_t size() const
+  {
+    return rowPitch() * height;
+  }
+};
+
+// Planes of one frame packed into a single buffer, rows tightly packed.
+// Plane offsets are 4-byte aligned so they can be used as bufferOffset of a buffer to image copy.
+struct PlaneLayout
+{
+  uint32_t count = 0;
+  std::array<Plane, maxPlaneCount> planes;
+  size_t size = 0;
+};
+
+inline PlaneLayout planeLayout(PixelFormat format, uint32_t width, uint32_t height)
+{
+  const auto chromaWidth = (width + 1) / 2;
+  const auto chromaHeight = (height + 1) / 2;
+
+  PlaneLayout layout;
+  const auto add = [&layout](uint32_t w, uint32_t h, uint32_t bytesPerPixel, uint32_t subsampling) {
+    const auto offset = (layout.size + 3) & ~size_t(3);
+    layout.planes[layout.count++] = Plane{ .width = w, .height = h, .bytesPerPixel = bytesPerPixel, .subsampling = subsampling, .offset = offset };
+    layout.size = offset + size_t(w) * h * bytesPerPixel;
+  };
+
+  switch (format)
+  {
+    case PixelFormat::eRGBA8:
+      add(width, height, 4, 0);
+      break;
+    case PixelFormat::eYUV420P:
+      add(width, height, 1, 0);
+      add(chromaWidth, chromaHeight, 1, 1);
+      add(chromaWidth, chromaHeight, 1, 1);
+      break;
+    case PixelFormat::eNV12:
+      add(width, height, 1, 0);
+      add(chromaWidth, chromaHeight, 2, 1);
+      break;
+  }
+
+  return layout;
+}
+
+}}} // namespace daia::player::common
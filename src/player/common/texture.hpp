@@ -1,93 +1,148 @@
-#pragma once
-
-#define VULKAN_HPP_NO_CONSTRUCTORS
-#include <vulkan/vulkan.hpp>
-
-#include "util.hpp"
-
-namespace daia { namespace player { namespace common {
-
-struct Texture
-{
-  vk::UniqueImage image;
-  vk::UniqueDeviceMemory memory;
-  vk::UniqueImageView view;
-  vk::UniqueSampler sampler;
-  vk::Extent2D extent;
-
-  void setup(const vk::UniqueDevice& device, const vk::PhysicalDevice& physicalDevice, uint32_t width, uint32_t height)
-  {
-    const auto format = vk::Format::eR8G8B8A8Unorm;
-
-    image = device->createImageUnique({
-      .imageType = vk::ImageType::e2D,
-      .format = format,
-      .extent = { width, height, 1 },
-      .mipLevels = 1,
-      .arrayLayers = 1,
-      .samples = vk::SampleCountFlagBits::e1,
-      .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-      .sharingMode = vk::SharingMode::eExclusive,
-      .initialLayout = vk::ImageLayout::eUndefined,
-    });
-
-    const auto memReqs = device->getImageMemoryRequirements(*image);
-    memory = device->allocateMemoryUnique({
-      .allocationSize = memReqs.size,
-      .memoryTypeIndex = findMemoryType(
-        physicalDevice,
-        memReqs.memoryTypeBits,
-        vk::MemoryPropertyFlagBits::eDeviceLocal),
-    });
-    device->bindImageMemory(*image, *memory, 0);
-
-    view = device->createImageViewUnique(
-      { .image = *image,
-        .viewType = vk::ImageViewType::e2D,
-        .format = format,
-        .subresourceRange = {
-          .aspectMask = vk::ImageAspectFlagBits::eColor,
-          .baseMipLevel = 0,
-          .levelCount = 1,
-          .baseArrayLayer = 0,
-          .layerCount = 1,
-        } });
-
-    sampler = device->createSamplerUnique(
-      {
-        .magFilter = vk::Filter::eLinear,
-        .minFilter = vk::Filter::eLinear,
-        .mipmapMode = vk::SamplerMipmapMode::eLinear,
-        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
-        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
-        .addressModeW = vk::SamplerAddressMode::eClampToEdge,
-      });
-
-    extent = vk::Extent2D{ width, height };
-  }
-
-  size_t calcBufferSize() const
-  {
-    return extent.width * extent.height * sizeof(uint32_t);
-  }
-
-  vk::DescriptorImageInfo createDescriptorInfo() const
-  {
-    return vk::DescriptorImageInfo{
-      .sampler = *sampler,
-      .imageView = *view,
-      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-    };
-  }
-
-  void destroy()
-  {
-    sampler.reset();
-    view.reset();
-    memory.reset();
-    image.reset();
-    extent = vk::Extent2D{ 0, 0 };
-  }
-};
-
-}}} // namespace daia::player::common
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "util.hpp"
+
+namespace daia { namespace player { namespace common {
+
+struct Texture
+{
+  vk::UniqueImage image;
+  vk::UniqueDeviceMemory memory;
+  vk::UniqueImageView view;
+  vk::UniqueSampler sampler;
+  vk::Extent2D extent;
+  vk::Format format = vk::Format::eUndefined;
+  uint32_t mipLevels = 1;
+
+  // levels of a full mip chain down to 1x1
+  static uint32_t mipLevelCount(uint32_t width, uint32_t height)
+  {
+    return std::bit_width(std::max(width, height));
+  }
+
+  // one texel of 1, 2 or 4 bytes maps to R8, R8G8 or R8G8B8A8
+  static vk::Format formatFromBytesPerPixel(uint32_t bytesPerPixel)
+  {
+    switch (bytesPerPixel)
+    {
+      case 1:
+        return vk::Format::eR8Unorm;
+      case 2:
+        return vk::Format::eR8G8Unorm;
+      default:
+        return vk::Format::eR8G8B8A8Unorm;
+    }
+  }
+
+  // more than one queue family makes the image concurrently shared between them.
+  // mip levels past the first are blitted from level 0, so mipmapped images are transfer sources too
+  void setup(
+    const vk::UniqueDevice& device,
+    const vk::PhysicalDevice& physicalDevice,
+    uint32_t width,
+    uint32_t height,
+    vk::Format format = vk::Format::eR8G8B8A8Unorm,
+    const std::vector<uint32_t>& queueFamilies = {},
+    uint32_t mipLevels = 1)
+  {
+    this->format = format;
+    this->mipLevels = std::max<uint32_t>(mipLevels, 1);
+    const bool concurrent = queueFamilies.size() > 1;
+    auto usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    if (this->mipLevels > 1)
+    {
+      usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+
+    image = device->createImageUnique({
+      .imageType = vk::ImageType::e2D,
+      .format = format,
+      .extent = { width, height, 1 },
+      .mipLevels = this->mipLevels,
+      .arrayLayers = 1,
+      .samples = vk::SampleCountFlagBits::e1,
+      .usage = usage,
+      .sharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+      .queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(queueFamilies.size()) : 0,
+      .pQueueFamilyIndices = concurrent ? queueFamilies.data() : nullptr,
+      .initialLayout = vk::ImageLayout::eUndefined,
+    });
+
+    const auto memReqs = device->getImageMemoryRequirements(*image);
+    memory = device->allocateMemoryUnique({
+      .allocationSize = memReqs.size,
+      .memoryTypeIndex = findMemoryType(
+        physicalDevice,
+        memReqs.memoryTypeBits,
+        vk::MemoryPropertyFlagBits::eDeviceLocal),
+    });
+    device->bindImageMemory(*image, *memory, 0);
+
+    view = device->createImageViewUnique(
+      { .image = *image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = format,
+        .subresourceRange = {
+          .aspectMask = vk::ImageAspectFlagBits::eColor,
+          .baseMipLevel = 0,
+          .levelCount = this->mipLevels,
+          .baseArrayLayer = 0,
+          .layerCount = 1,
+        } });
+
+    sampler = device->createSamplerUnique(
+      {
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eLinear,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+        .maxLod = static_cast<float>(this->mipLevels),
+      });
+
+    extent = vk::Extent2D{ width, height };
+  }
+
+  size_t calcBufferSize() const
+  {
+    switch (format)
+    {
+      case vk::Format::eR8Unorm:
+        return extent.width * extent.height;
+      case vk::Format::eR8G8Unorm:
+        return extent.width * extent.height * 2;
+      default:
+        return extent.width * extent.height * sizeof(uint32_t);
+    }
+  }
+
+  vk::DescriptorImageInfo createDescriptorInfo() const
+  {
+    return vk::DescriptorImageInfo{
+      .sampler = *sampler,
+      .imageView = *view,
+      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+    };
+  }
+
+  void destroy()
+  {
+    sampler.reset();
+    view.reset();
+    memory.reset();
+    image.reset();
+    extent = vk::Extent2D{ 0, 0 };
+    format = vk::Format::eUndefined;
+    mipLevels = 1;
+  }
+};
+
+}}} // namespace daia::player::common
@@ -1,5 +1,5 @@
-#pragma once
-
-#include "content_base.hpp"
-#include "empty_content.hpp"
-#include "video_content.hpp"
+#pragma once
+
+#include "content_base.hpp"
+#include "empty_content.hpp"
+#include "video_content.hpp"
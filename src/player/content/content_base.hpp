@@ -1,36 +1,112 @@
-#pragma once
-
-#define VULKAN_HPP_NO_CONSTRUCTORS
-#include <vulkan/vulkan.hpp>
-
-#include "../../util/util.hpp"
-
-namespace daia { namespace player { namespace content {
-
-struct SetupArgs
-{
-  const vk::UniqueDevice& device;
-  const vk::PhysicalDevice& physicalDevice;
-};
-
-struct UpdateArgs
-{
-  double time = 0;
-
-  // ペイン系をそのうちまとめる
-  float width;
-  float height;
-};
-
-class Content
-{
-public:
-  virtual ~Content() = default;
-  virtual void setup(const SetupArgs info) = 0;
-  virtual void destroy() = 0;
-  virtual bool update(const UpdateArgs info) = 0;
-  virtual util::uint2 size() const = 0;
-  virtual std::span<const uint32_t> data() const = 0;
-};
-
-}}} // namespace daia::player::content
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "../../util/util.hpp"
+#include "../common/pixel_format.hpp"
+
+namespace daia { namespace player { namespace content {
+
+struct SetupArgs
+{
+  const vk::UniqueDevice& device;
+  const vk::PhysicalDevice& physicalDevice;
+  float width = 0; // of the pane that shows the content, 1x1 when none does yet. 0 when unknown
+  float height = 0;
+};
+
+struct UpdateArgs
+{
+  double time = 0;
+  bool waitForFrames = false; // block until the frame due at time is ready, so the shown frame depends on time only
+
+  // ペイン系をそのうちまとめる
+  float width;
+  float height;
+};
+
+enum class OpenState
+{
+  eOpening, // size() and format() are not known yet
+  eReady,
+  eFailed,
+};
+
+class Content
+{
+public:
+  virtual ~Content() = default;
+  virtual void setup(const SetupArgs info) = 0;
+  virtual void destroy() = 0;
+  virtual bool update(const UpdateArgs info) = 0;
+  virtual util::uint2 size() const = 0;
+
+  // called when no pane shows the content anymore. update() is not called until resume().
+  // releaseBuffers asks to free memory that can be recreated, the texture keeps the last frame anyway
+  virtual void suspend(bool releaseBuffers)
+  {
+  }
+
+  // called before the first update() after the content is shown again, with the time of that update
+  virtual void resume(double time)
+  {
+  }
+
+  // decode work per frame relative to a 1080p H.264 frame. 0 for contents that do not decode
+  virtual double decodeCost() const
+  {
+    return 0;
+  }
+
+  // threads the content may use for decoding, its share of the pipeline's decode thread budget
+  virtual void setDecodeThreads(uint32_t threadCount)
+  {
+  }
+
+  // contents opened off the render thread are set up and get textures once they are ready
+  virtual OpenState openState() const
+  {
+    return OpenState::eReady;
+  }
+
+  // pixels laid out as common::planeLayout(format(), size())
+  virtual std::span<const uint8_t> data() const = 0;
+
+  // writes the current frame into dst, a mapped staging region of planeLayout(format(), size()).size bytes.
+  // contents that produce pixels on demand override this and skip their own copy in data().
+  // false when dst cannot hold the frame; nothing is written then
+  virtual bool write(std::span<uint8_t> dst)
+  {
+    const auto src = data();
+    if (dst.size() < src.size())
+    {
+      return false;
+    }
+    std::memcpy(dst.data(), src.data(), src.size());
+    return true;
+  }
+
+  // parts of the current frame that changed since the previous one. empty means the whole frame
+  virtual std::span<const common::Region> changedRegions() const
+  {
+    return {};
+  }
+
+  virtual common::PixelFormat format() const
+  {
+    return common::PixelFormat::eRGBA8;
+  }
+
+  // used for YUV formats only
+  virtual common::ColorSpace colorSpace() const
+  {
+    return {};
+  }
+};
+
+}}} // namespace daia::player::content
@@ -1,43 +1,289 @@
-#pragma once
-
-#include "../media/video.hpp"
-#include "content_base.hpp"
-
-namespace daia { namespace player { namespace content {
-
-class VideoContent : public Content
-{
-public:
-  void setup(const SetupArgs info) {}
-
-  void destroy() {}
-
-  util::uint2 size() const
-  {
-    return { static_cast<uint32_t>(_video.width()), static_cast<uint32_t>(_video.height()) };
-  }
-
-  bool update(const UpdateArgs info)
-  {
-    _frame = _video.getFrame(0);
-    return true;
-  }
-
-  std::span<const uint32_t> data() const
-  {
-    return _frame;
-  }
-
-  VideoContent(const std::filesystem::path& path)
-  {
-    filePath = path;
-    _video.setup(path);
-  }
-
-private:
-  std::filesystem::path filePath;
-  media::Video _video;
-  std::vector<uint32_t> _frame;
-};
-
-}}} // namespace daia::player::content
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <optional>
+
+#include "../../util/thread_budget.hpp"
+#include "../../util/trace.hpp"
+#include "../media/video_decoder.hpp"
+#include "content_base.hpp"
+
+namespace daia { namespace player { namespace content {
+
+class VideoContent : public Content
+{
+public:
+  // output sizes grow with some slack and only shrink when the pane needs less than half the pixels,
+  // so resizing a window does not reallocate the textures every frame
+  static constexpr double outputGrowth = 1.25;
+  static constexpr double outputShrinkArea = 0.5;
+
+  // starts decoding at the pane size, so the first texture is not made for the full source
+  void setup(const SetupArgs info)
+  {
+    if (info.width > 0 && info.height > 0)
+    {
+      _fitOutputSize(info.width, info.height);
+    }
+    _decoder.start();
+  }
+
+  // opens and indexes the file. slow on large or remote files, so it is meant to run on a worker thread
+  bool open()
+  {
+    DAIA_TRACE_SCOPE("VideoContent::open");
+    std::lock_guard lock(_openMutex);
+    if (_state != OpenState::eOpening)
+    {
+      return _state == OpenState::eReady;
+    }
+    const auto opened = _decoder.setup(filePath, _readAhead, &_cancelled) && !_cancelled;
+    if (_cancelled)
+    {
+      // destroy() did not wait for this open, so the decoder is released here
+      _decoder.destroy();
+    }
+    _state = opened ? OpenState::eReady : OpenState::eFailed;
+    return opened;
+  }
+
+  OpenState openState() const
+  {
+    return _state;
+  }
+
+  void destroy()
+  {
+    // an open() in progress is cancelled and releases the decoder itself, so the caller never waits for the file
+    _cancelled = true;
+    std::unique_lock lock(_openMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+      return;
+    }
+    _state = OpenState::eFailed;
+    _decoder.destroy();
+  }
+
+  // of the current frame, which follows the pane size. the decoder's output size until a frame is shown
+  util::uint2 size() const
+  {
+    if (_frame.width > 0)
+    {
+      return { static_cast<uint32_t>(_frame.width), static_cast<uint32_t>(_frame.height) };
+    }
+    return _decoder.outputSize();
+  }
+
+  // shows the last frame that is due at info.time. frames that became due while a later one is also due are dropped unseen.
+  // the stream clock is anchored to the global clock at the first frame after setup or seek
+  bool update(const UpdateArgs info)
+  {
+    _time = info.time;
+    _fitOutputSize(info.width, info.height);
+
+    bool changed = false;
+    while (true)
+    {
+      if (!_next)
+      {
+        // decoding runs on the decode scheduler. only take a frame if one is ready, unless the caller waits for it
+        _next = info.waitForFrames ? _decoder.pop() : _decoder.tryPop();
+        if (!_next)
+        {
+          break;
+        }
+      }
+
+      // frames without a timestamp are due immediately
+      if (_next->pts != AV_NOPTS_VALUE)
+      {
+        const auto seconds = _next->pts * av_q2d(_decoder.timeBase());
+        if (!_clockOffset)
+        {
+          _clockOffset = info.time - seconds;
+        }
+        if (seconds + *_clockOffset > info.time)
+        {
+          // not due yet
+          break;
+        }
+      }
+
+      if (changed)
+      {
+        _droppedFrames++;
+      }
+      _decoder.recycle(std::move(_frame));
+      _frame = std::move(*_next);
+      _next.reset();
+      changed = true;
+    }
+
+    // the frame after the newest one taken is due next. the decode scheduler serves the earliest deadlines first
+    const auto& newest = _next ? *_next : _frame;
+    if (_clockOffset && newest.pts != AV_NOPTS_VALUE)
+    {
+      _decoder.setDeadline(newest.pts * av_q2d(_decoder.timeBase()) + *_clockOffset);
+    }
+    return changed;
+  }
+
+  // stops scheduling decode steps. the stream clock keeps running, so resume() continues where playback would be by then
+  void suspend(bool releaseBuffers)
+  {
+    _decoder.stop();
+    if (_next)
+    {
+      _decoder.recycle(std::move(*_next));
+      _next.reset();
+    }
+    if (releaseBuffers)
+    {
+      _decoder.recycle(std::move(_frame));
+      _frame = {};
+      _decoder.releaseBuffers();
+    }
+  }
+
+  void resume(double time)
+  {
+    _seekToClock(time);
+  }
+
+  double decodeCost() const
+  {
+    return _decoder.decodeCost();
+  }
+
+  // small changes of the share are ignored. the decoder reopens its codec at the next IDR frame or seek, so the stream plays on
+  void setDecodeThreads(uint32_t threadCount)
+  {
+    if (util::threadShareChanged(static_cast<uint32_t>(_decoder.threadCount()), threadCount))
+    {
+      _decoder.setThreadCount(static_cast<int>(threadCount));
+    }
+  }
+
+  // frames skipped because a later frame was already due
+  uint64_t droppedFrames() const
+  {
+    return _droppedFrames;
+  }
+
+  // empty for planar frames of the decoded size, which are only available through write()
+  std::span<const uint8_t> data() const
+  {
+    return _frame.data;
+  }
+
+  bool write(std::span<uint8_t> dst)
+  {
+    return _decoder.write(_frame, dst);
+  }
+
+  common::PixelFormat format() const
+  {
+    return _decoder.outputFormat();
+  }
+
+  common::ColorSpace colorSpace() const
+  {
+    return _decoder.colorSpace();
+  }
+
+  void seek(double seconds)
+  {
+    if (_next)
+    {
+      _decoder.recycle(std::move(*_next));
+      _next.reset();
+    }
+    _decoder.seek(_decoder.frameAtTime(seconds));
+    _clockOffset.reset();
+  }
+
+  media::ReadAheadStats readAheadStats() const
+  {
+    return _state == OpenState::eReady ? _decoder.readAheadStats() : media::ReadAheadStats{};
+  }
+
+  // the file is not touched until open()
+  VideoContent(const std::filesystem::path& path, media::ReadAheadOptions readAhead = {})
+    : _readAhead(readAhead)
+  {
+    filePath = path;
+  }
+
+private:
+  // converts frames straight to the pane size instead of the source size, never larger than the source.
+  // downscales of 2x and more also decode with less quality, see media::Video::setDecodeScale
+  void _fitOutputSize(float paneWidth, float paneHeight)
+  {
+    const auto sourceWidth = _decoder.width();
+    const auto sourceHeight = _decoder.height();
+    const auto targetWidth = std::clamp(static_cast<int>(std::ceil(paneWidth)), 1, sourceWidth);
+    const auto targetHeight = std::clamp(static_cast<int>(std::ceil(paneHeight)), 1, sourceHeight);
+
+    const auto [w, h] = _decoder.outputSize();
+    const auto width = static_cast<int>(w);
+    const auto height = static_cast<int>(h);
+    const auto tooSmall = width < targetWidth || height < targetHeight;
+    const auto tooLarge = double(width) * height * outputShrinkArea > double(targetWidth) * targetHeight;
+    if (!tooSmall && !tooLarge)
+    {
+      return;
+    }
+
+    const auto slack = tooSmall ? outputGrowth : 1.0;
+    const auto outputWidth = std::min(static_cast<int>(std::ceil(targetWidth * slack)), sourceWidth);
+    const auto outputHeight = std::min(static_cast<int>(std::ceil(targetHeight * slack)), sourceHeight);
+    _decoder.setOutputSize(outputWidth, outputHeight);
+
+    const auto downscale = std::min(double(sourceWidth) / outputWidth, double(sourceHeight) / outputHeight);
+    const auto scale = downscale >= 4 ? 2 : downscale >= 2 ? 1 : 0;
+    if (scale != _decoder.decodeScale())
+    {
+      // the codec is reopened, so decoding restarts from the frame that is due now
+      _decoder.stop();
+      _decoder.setDecodeScale(scale);
+      _seekToClock(_time);
+    }
+  }
+
+  // restarts decoding at the frame the stream clock says is due at time
+  void _seekToClock(double time)
+  {
+    if (_next)
+    {
+      _decoder.recycle(std::move(*_next));
+      _next.reset();
+    }
+    if (!_clockOffset)
+    {
+      // nothing shown yet
+      _decoder.seek(0);
+      return;
+    }
+    const auto pts = static_cast<int64_t>((time - *_clockOffset) / av_q2d(_decoder.timeBase()));
+    _decoder.seek(_decoder.frameAt(pts));
+  }
+
+  std::filesystem::path filePath;
+  media::ReadAheadOptions _readAhead;
+  media::VideoDecoder _decoder;
+  media::DecodedFrame _frame;
+  std::optional<media::DecodedFrame> _next; // popped from the decoder but not due yet
+  std::optional<double> _clockOffset;       // global time - stream time
+  uint64_t _droppedFrames = 0;
+  double _time = 0; // of the last update()
+
+  std::mutex _openMutex;
+  std::atomic<bool> _cancelled = false; // set by destroy(), interrupts open()
+  std::atomic<OpenState> _state = OpenState::eOpening;
+};
+
+}}} // namespace daia::player::content
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "../../util/trace.hpp"
+
+namespace daia { namespace player { namespace media {
+
+// Worker pool shared by the demux, decode and convert steps of every VideoDecoder.
+// Each worker has its own task list. A worker runs its task with the earliest deadline; when it has none,
+// it steals the earliest task of the other workers, so work of streams that fall behind is picked up first.
+// Tasks must not block on other tasks: a step that cannot continue returns and is submitted again when it can.
+class DecodeScheduler
+{
+public:
+  struct Task
+  {
+    double deadline = 0; // global time the work is needed by. earlier runs first
+    std::function<void()> run;
+  };
+
+  static constexpr size_t tasksPerWorker = 64;
+
+  explicit DecodeScheduler(size_t threadCount)
+  {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; i++)
+    {
+      _workers.push_back(std::make_unique<Worker>());
+      _workers.back()->tasks.reserve(tasksPerWorker);
+    }
+    for (size_t i = 0; i < threadCount; i++)
+    {
+      _workers[i]->thread = std::jthread([this, i](std::stop_token stop) { _run(i, stop); });
+    }
+  }
+
+  ~DecodeScheduler()
+  {
+    for (auto& worker : _workers)
+    {
+      worker->thread.request_stop();
+    }
+    _available.notify_all();
+    for (auto& worker : _workers)
+    {
+      if (worker->thread.joinable())
+      {
+        worker->thread.join();
+      }
+    }
+  }
+
+  DecodeScheduler(const DecodeScheduler&) = delete;
+  DecodeScheduler& operator=(const DecodeScheduler&) = delete;
+
+  // one worker per core, shared by every decoder of the process
+  static DecodeScheduler& shared()
+  {
+    static DecodeScheduler scheduler(std::thread::hardware_concurrency());
+    return scheduler;
+  }
+
+  // a task submitted from a worker stays on that worker unless it is stolen
+  void submit(Task task)
+  {
+    auto& worker = _currentScheduler == this ? *_workers[_currentWorker] : *_workers[_next++ % _workers.size()];
+    {
+      std::lock_guard lock(worker.mutex);
+      worker.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard lock(_mutex);
+      _pending++;
+    }
+    _available.notify_one();
+  }
+
+  size_t threadCount() const
+  {
+    return _workers.size();
+  }
+
+private:
+  struct Worker
+  {
+    std::mutex mutex;
+    std::vector<Task> tasks;
+    std::jthread thread;
+  };
+
+  // removes the task with the earliest deadline of a worker
+  static bool _take(Worker& worker, Task& task)
+  {
+    std::lock_guard lock(worker.mutex);
+    if (worker.tasks.empty())
+    {
+      return false;
+    }
+    const auto it = std::min_element(worker.tasks.begin(), worker.tasks.end(), [](const Task& a, const Task& b) { return a.deadline < b.deadline; });
+    task = std::move(*it);
+    *it = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+  }
+
+  // the earliest task of the other workers
+  bool _steal(size_t self, Task& task)
+  {
+    size_t victim = self;
+    double earliest = 0;
+    for (size_t i = 0; i < _workers.size(); i++)
+    {
+      if (i == self)
+      {
+        continue;
+      }
+      std::lock_guard lock(_workers[i]->mutex);
+      for (const auto& t : _workers[i]->tasks)
+      {
+        if (victim == self || t.deadline < earliest)
+        {
+          victim = i;
+          earliest = t.deadline;
+        }
+      }
+    }
+    // the task may be taken by its owner in between. then the next loop tries again
+    return victim != self && _take(*_workers[victim], task);
+  }
+
+  void _run(size_t self, std::stop_token stop)
+  {
+    util::trace::setThreadName("decode worker");
+    _currentScheduler = this;
+    _currentWorker = self;
+    Task task;
+    while (true)
+    {
+      // claim one of the pending tasks, then find it. tasks are only removed by claimers, so there is one
+      {
+        std::unique_lock lock(_mutex);
+        if (!_available.wait(lock, stop, [this] { return _pending > 0; }))
+        {
+          return;
+        }
+        _pending--;
+      }
+      while (!_take(*_workers[self], task) && !_steal(self, task))
+      {
+        // another claimer got to the task found by _steal first
+        std::this_thread::yield();
+      }
+      task.run();
+      task.run = nullptr;
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::atomic<size_t> _next = 0;
+
+  std::mutex _mutex;
+  std::condition_variable_any _available;
+  size_t _pending = 0; // submitted tasks not claimed by a worker yet
+
+  static inline thread_local const DecodeScheduler* _currentScheduler = nullptr;
+  static inline thread_local size_t _currentWorker = 0;
+};
+
+}}} // namespace daia::player::media
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace daia { namespace player { namespace media {
+
+// RAII wrappers for FFmpeg structures
+
+struct FormatContextDeleter
+{
+  void operator()(AVFormatContext* p) const
+  {
+    avformat_close_input(&p);
+  }
+};
+
+struct CodecContextDeleter
+{
+  void operator()(AVCodecContext* p) const
+  {
+    avcodec_free_context(&p);
+  }
+};
+
+struct FrameDeleter
+{
+  void operator()(AVFrame* p) const
+  {
+    av_frame_free(&p);
+  }
+};
+
+struct PacketDeleter
+{
+  void operator()(AVPacket* p) const
+  {
+    av_packet_free(&p);
+  }
+};
+
+struct ScaleContextDeleter
+{
+  void operator()(SwsContext* p) const
+  {
+    sws_freeContext(p);
+  }
+};
+
+using FormatContext = std::unique_ptr<AVFormatContext, FormatContextDeleter>;
+using CodecContext = std::unique_ptr<AVCodecContext, CodecContextDeleter>;
+using Frame = std::unique_ptr<AVFrame, FrameDeleter>;
+using Packet = std::unique_ptr<AVPacket, PacketDeleter>;
+using ScaleContext = std::unique_ptr<SwsContext, ScaleContextDeleter>;
+
+inline Frame makeFrame()
+{
+  return Frame(av_frame_alloc());
+}
+
+inline Packet makePacket()
+{
+  return Packet(av_packet_alloc());
+}
+
+}}} // namespace daia::player::media
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "ffmpeg.hpp"
+
+namespace daia { namespace player { namespace media {
+
+// Frame numbers and keyframes of one stream, built without reading the file.
+// Frame n is presented at start + n * frame duration of the stream's average frame rate; a timestamp belongs to the
+// nearest frame, so timestamps rounded by the container still match. In variable frame rate streams the numbers are
+// approximate, but seeking by them still lands on the right timestamps.
+// Keyframes come from the demuxer's index (mp4, mkv cues, avi) and from the packets demuxed since,
+// which is how files without an index learn theirs during playback.
+class FrameIndex
+{
+public:
+  struct Keyframe
+  {
+    int64_t frame;
+    int64_t pts;
+    int64_t dts;
+  };
+
+  // fails when the stream has no frame rate or no duration
+  bool build(AVFormatContext* formatContext, int streamIndex)
+  {
+    auto* stream = formatContext->streams[streamIndex];
+    auto rate = stream->avg_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0)
+    {
+      rate = stream->r_frame_rate;
+    }
+    if (rate.num <= 0 || rate.den <= 0)
+    {
+      return false;
+    }
+    _frameDuration = 1 / (av_q2d(rate) * av_q2d(stream->time_base));
+    _start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    if (stream->nb_frames > 0)
+    {
+      _frameCount = stream->nb_frames;
+    }
+    else if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+    {
+      _frameCount = static_cast<int64_t>(std::ceil(stream->duration / _frameDuration));
+    }
+    else if (formatContext->duration != AV_NOPTS_VALUE && formatContext->duration > 0)
+    {
+      const auto duration = formatContext->duration / static_cast<double>(AV_TIME_BASE) / av_q2d(stream->time_base);
+      _frameCount = static_cast<int64_t>(std::ceil(duration / _frameDuration));
+    }
+    else
+    {
+      return false;
+    }
+
+    // the first keyframe is the start of decoding even if the index does not list it
+    std::lock_guard lock(_mutex);
+    _keyframes.clear();
+    _keyframes.push_back({ .frame = 0, .pts = _start, .dts = _start });
+
+    const auto count = avformat_index_get_entries_count(stream);
+    _indexed = count > 0;
+    for (int i = 0; i < count; i++)
+    {
+      const auto* entry = avformat_index_get_entry(stream, i);
+      if (entry && (entry->flags & AVINDEX_KEYFRAME))
+      {
+        // index timestamps are decode times. a keyframe is presented no earlier, so its frame is a safe lower bound
+        _insertLocked(entry->timestamp, entry->timestamp);
+      }
+    }
+    return true;
+  }
+
+  // records a keyframe packet seen by the demuxer. safe while other threads look keyframes up
+  void addKeyframe(int64_t pts, int64_t dts)
+  {
+    std::lock_guard lock(_mutex);
+    _insertLocked(pts, dts);
+  }
+
+  // the demuxer has its own index, so seeks to keyframes it lists are exact
+  bool indexed() const
+  {
+    return _indexed;
+  }
+
+  int64_t frameCount() const
+  {
+    return _frameCount;
+  }
+
+  // nominal pts of frame
+  int64_t pts(int64_t frame) const
+  {
+    frame = std::clamp<int64_t>(frame, 0, std::max<int64_t>(frameCount() - 1, 0));
+    return _start + std::llround(frame * _frameDuration);
+  }
+
+  // the lowest pts of a decoded frame that is frame or later. half a frame before its nominal pts
+  int64_t earliestPts(int64_t frame) const
+  {
+    return pts(frame) - static_cast<int64_t>(_frameDuration / 2);
+  }
+
+  // the frame a pts belongs to
+  int64_t frameAt(int64_t pts) const
+  {
+    const auto frame = static_cast<int64_t>(std::floor((pts - _start) / _frameDuration + 0.5));
+    return std::clamp<int64_t>(frame, 0, std::max<int64_t>(frameCount() - 1, 0));
+  }
+
+  // the last known keyframe at or before frame
+  Keyframe keyframeBefore(int64_t frame) const
+  {
+    std::lock_guard lock(_mutex);
+    const auto it = std::upper_bound(_keyframes.begin(), _keyframes.end(), frame, [](int64_t f, const Keyframe& k) { return f < k.frame; });
+    return it == _keyframes.begin() ? _keyframes.front() : *std::prev(it);
+  }
+
+private:
+  void _insertLocked(int64_t pts, int64_t dts)
+  {
+    const auto keyframe = Keyframe{ .frame = frameAt(pts), .pts = pts, .dts = dts };
+    const auto it = std::lower_bound(_keyframes.begin(), _keyframes.end(), keyframe, [](const Keyframe& a, const Keyframe& b) { return a.dts < b.dts; });
+    if (it != _keyframes.end() && it->dts == dts)
+    {
+      return;
+    }
+    if (keyframe.frame == 0 || (it != _keyframes.begin() && std::prev(it)->frame >= keyframe.frame) || (it != _keyframes.end() && it->frame <= keyframe.frame))
+    {
+      // not between its neighbours: seeking there gains nothing and would break the frame order
+      return;
+    }
+    _keyframes.insert(it, keyframe);
+  }
+
+  double _frameDuration = 1; // in stream time base units
+  int64_t _start = 0;
+  int64_t _frameCount = 0;
+  bool _indexed = false;
+
+  mutable std::mutex _mutex;
+  std::vector<Keyframe> _keyframes; // ordered by dts and frame
+};
+
+}}} // namespace daia::player::media
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../../util/pool.hpp"
+#include "../../util/thread_pool.hpp"
+#include "../../util/trace.hpp"
+#include "ffmpeg.hpp"
+
+namespace daia { namespace player { namespace media {
+
+struct ReadAheadOptions
+{
+  size_t window = 16 << 20;   // bytes read ahead of the demuxer. 0 reads through libavformat's own file I/O
+  size_t chunkSize = 1 << 20; // size of one read
+};
+
+struct ReadAheadStats
+{
+  uint64_t bytesRead = 0;
+  double readSeconds = 0;  // spent in file reads on the i/o threads
+  double stallSeconds = 0; // the demuxer waited for data
+  uint64_t stalls = 0;
+
+  double bytesPerSecond() const
+  {
+    return readSeconds > 0 ? bytesRead / readSeconds : 0;
+  }
+};
+
+// AVIOContext reading a file through a window of large chunks filled ahead of the demuxer.
+// Chunks are read by a small pool of i/o threads shared by every stream; a stream has at most one read task at a time,
+// which reads until the window is full. Seeks inside the window are free, others restart reading at the target.
+class ReadAhead
+{
+public:
+  static constexpr int ioBufferSize = 64 << 10;
+  static constexpr size_t ioThreadCount = 4;
+
+  ReadAhead() = default;
+  ReadAhead(const ReadAhead&) = delete;
+  ReadAhead& operator=(const ReadAhead&) = delete;
+
+  ~ReadAhead()
+  {
+    close();
+  }
+
+  bool open(const std::filesystem::path& path, ReadAheadOptions options)
+  {
+    _file.open(path, std::ios::binary | std::ios::ate);
+    if (!_file.is_open())
+    {
+      return false;
+    }
+    _size = static_cast<int64_t>(_file.tellg());
+    _options = options;
+    _options.chunkSize = std::max<size_t>(_options.chunkSize, ioBufferSize);
+    _options.window = std::max(_options.window, _options.chunkSize);
+    _chunkPool = std::make_unique<util::Pool<std::vector<uint8_t>>>(_options.window / _options.chunkSize + 2);
+
+    auto* buffer = static_cast<uint8_t*>(av_malloc(ioBufferSize));
+    _context = avio_alloc_context(buffer, ioBufferSize, 0, this, &ReadAhead::_read, nullptr, &ReadAhead::_seek);
+
+    _fill();
+    return true;
+  }
+
+  // set as AVFormatContext::pb with AVFMT_FLAG_CUSTOM_IO. must outlive the format context
+  AVIOContext* context() const
+  {
+    return _context;
+  }
+
+  ReadAheadStats stats() const
+  {
+    std::lock_guard lock(_mutex);
+    return _stats;
+  }
+
+  // waits for a read in progress. a read the pool dropped without running it is not waited for
+  void close()
+  {
+    {
+      std::unique_lock lock(_mutex);
+      _closed = true;
+      _idle.wait(lock, [this] { return !_reading; });
+      _chunks.clear();
+    }
+    if (_context)
+    {
+      av_freep(&_context->buffer);
+      avio_context_free(&_context);
+    }
+    _file.close();
+  }
+
+private:
+  struct Chunk
+  {
+    int64_t offset = 0;
+    std::vector<uint8_t> data;
+  };
+
+  static util::ThreadPool& _ioPool()
+  {
+    static util::ThreadPool pool(ioThreadCount, "read-ahead");
+    return pool;
+  }
+
+  int64_t _bufferedEnd() const
+  {
+    return _chunks.empty() ? _readPosition : _chunks.back().offset + static_cast<int64_t>(_chunks.back().data.size());
+  }
+
+  // starts a read task unless one is running or the window is full. call with _mutex held or before sharing
+  void _fill()
+  {
+    if (_reading || _closed || _readPosition >= _size || _readPosition - _position >= static_cast<int64_t>(_options.window))
+    {
+      return;
+    }
+    // both tasks only capture this, which std::function keeps inline: submitting does not allocate
+    _reading = true;
+    if (!_ioPool().submit([this] { _readChunks(); }, [this] { _readDropped(); }))
+    {
+      // the pool is stopped. the demuxer gets an error instead of waiting for data
+      _reading = false;
+    }
+  }
+
+  // the pool was stopped (at exit) before the read ran
+  void _readDropped()
+  {
+    std::lock_guard lock(_mutex);
+    _reading = false;
+    _available.notify_all();
+    _idle.notify_all();
+  }
+
+  void _readChunks()
+  {
+    std::unique_lock lock(_mutex);
+    while (!_closed && _readPosition < _size && _readPosition - _position < static_cast<int64_t>(_options.window))
+    {
+      const auto offset = _readPosition;
+      const auto generation = _generation;
+      const auto size = static_cast<size_t>(std::min<int64_t>(_options.chunkSize, _size - offset));
+      lock.unlock();
+
+      // only this task touches the file
+      auto data = _chunkPool->acquire([] { return std::vector<uint8_t>(); });
+      data.resize(size);
+      const auto start = std::chrono::steady_clock::now();
+      {
+        DAIA_TRACE_SCOPE("ReadAhead::read");
+        _file.clear();
+        _file.seekg(offset);
+        _file.read(reinterpret_cast<char*>(data.data()), size);
+      }
+      const auto read = static_cast<size_t>(std::max<std::streamsize>(_file.gcount(), 0));
+      const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      lock.lock();
+      _stats.bytesRead += read;
+      _stats.readSeconds += seconds;
+      if (generation != _generation)
+      {
+        // a seek moved the window meanwhile
+        _chunkPool->release(std::move(data));
+        continue;
+      }
+      if (read == 0)
+      {
+        // the file shrank or cannot be read. the demuxer sees the end of the file
+        _size = offset;
+        break;
+      }
+      data.resize(read);
+      _chunks.push_back({ .offset = offset, .data = std::move(data) });
+      _readPosition = offset + static_cast<int64_t>(read);
+      _available.notify_all();
+    }
+    _reading = false;
+    _available.notify_all();
+    _idle.notify_all();
+  }
+
+  static int _read(void* opaque, uint8_t* buffer, int size)
+  {
+    auto& self = *static_cast<ReadAhead*>(opaque);
+    std::unique_lock lock(self._mutex);
+
+    if (self._position >= self._size)
+    {
+      return AVERROR_EOF;
+    }
+
+    const auto covered = [&self] {
+      return !self._chunks.empty() && self._chunks.front().offset <= self._position && self._position < self._bufferedEnd();
+    };
+    if (!covered())
+    {
+      const auto start = std::chrono::steady_clock::now();
+      self._fill();
+      self._available.wait(lock, [&] { return covered() || self._position >= self._size || (!self._reading && !covered()); });
+      self._stats.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      self._stats.stalls++;
+      if (!covered())
+      {
+        return self._position >= self._size ? AVERROR_EOF : AVERROR(EIO);
+      }
+    }
+
+    // copy from the chunks covering the position, then drop the chunks behind it
+    int copied = 0;
+    for (const auto& chunk : self._chunks)
+    {
+      const auto end = chunk.offset + static_cast<int64_t>(chunk.data.size());
+      if (copied == size || self._position < chunk.offset)
+      {
+        break;
+      }
+      if (self._position >= end)
+      {
+        continue;
+      }
+      const auto count = static_cast<int>(std::min<int64_t>(size - copied, end - self._position));
+      std::memcpy(buffer + copied, chunk.data.data() + (self._position - chunk.offset), count);
+      copied += count;
+      self._position += count;
+    }
+    self._dropConsumed();
+    self._fill();
+    return copied;
+  }
+
+  static int64_t _seek(void* opaque, int64_t offset, int whence)
+  {
+    auto& self = *static_cast<ReadAhead*>(opaque);
+    std::lock_guard lock(self._mutex);
+
+    switch (whence & ~AVSEEK_FORCE)
+    {
+      case AVSEEK_SIZE:
+        return self._size;
+      case SEEK_SET:
+        break;
+      case SEEK_CUR:
+        offset += self._position;
+        break;
+      case SEEK_END:
+        offset += self._size;
+        break;
+      default:
+        return -1;
+    }
+    if (offset < 0)
+    {
+      return -1;
+    }
+
+    self._position = offset;
+    if (self._chunks.empty() || offset < self._chunks.front().offset || offset > self._bufferedEnd())
+    {
+      // outside the window: read from the target. a read in flight is dropped when it returns
+      for (auto& chunk : self._chunks)
+      {
+        self._chunkPool->release(std::move(chunk.data));
+      }
+      self._chunks.clear();
+      self._readPosition = offset;
+      self._generation++;
+    }
+    self._dropConsumed();
+    self._fill();
+    return offset;
+  }
+
+  void _dropConsumed()
+  {
+    while (!_chunks.empty() && _chunks.front().offset + static_cast<int64_t>(_chunks.front().data.size()) <= _position)
+    {
+      _chunkPool->release(std::move(_chunks.front().data));
+      _chunks.pop_front();
+    }
+  }
+
+  ReadAheadOptions _options;
+  std::ifstream _file;
+  int64_t _size = 0;
+  AVIOContext* _context = nullptr;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _available;
+  std::condition_variable _idle;
+  std::deque<Chunk> _chunks;
+  std::unique_ptr<util::Pool<std::vector<uint8_t>>> _chunkPool;
+  int64_t _position = 0;     // of the demuxer
+  int64_t _readPosition = 0; // next offset to read ahead
+  uint64_t _generation = 0;  // bumped by seeks that drop the window
+  bool _reading = false;     // a read task is queued or running
+  bool _closed = false;
+  ReadAheadStats _stats;
+};
+
+}}} // namespace daia::player::media
@@ -1,149 +1,670 @@
-#pragma once
-
-#include <memory>
-extern "C" {
-#include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
-#include <libavutil/imgutils.h>
-#include <libswscale/swscale.h>
-}
-#include <filesystem>
-#include <vector>
-
-namespace daia { namespace player { namespace media {
-
-class Video
-{
-public:
-  bool setup(const std::filesystem::path& filepath)
-  {
-    {
-      auto fc = avformat_alloc_context();
-      if (avformat_open_input(&fc, reinterpret_cast<const char*>(filepath.u8string().c_str()), nullptr, nullptr) != 0)
-      {
-        fprintf(stderr, "Could not open input file.\n");
-        return false;
-      }
-      _formatContext = std::unique_ptr<AVFormatContext>(fc);
-    }
-
-    if (avformat_find_stream_info(_formatContext.get(), nullptr) < 0)
-    {
-      fprintf(stderr, "Failed to retrieve stream info.\n");
-      return false;
-    }
-
-    for (int i = 0; i < _formatContext->nb_streams; i++)
-    {
-      if (_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
-      {
-        _videoStreamIndex = i;
-        break;
-      }
-    }
-
-    if (_videoStreamIndex < 0)
-    {
-      fprintf(stderr, "Failed to find video stream\n");
-      return false;
-    }
-
-    const auto videoStream = _formatContext->streams[_videoStreamIndex];
-
-    auto codec = avcodec_find_decoder(videoStream->codecpar->codec_id);
-    _codecContext = std::unique_ptr<AVCodecContext>(avcodec_alloc_context3(codec));
-    avcodec_parameters_to_context(_codecContext.get(), videoStream->codecpar);
-    if (avcodec_open2(_codecContext.get(), codec, nullptr) < 0)
-    {
-      fprintf(stderr, "Failed to open codec\n");
-      return false;
-    }
-
-    return true;
-  }
-
-  std::vector<uint32_t> getFrame(int64_t frame) const
-  {
-    std::vector<uint32_t> buffer(width() * height());
-
-    auto packet = av_packet_alloc();
-
-    while (av_read_frame(_formatContext.get(), packet) >= 0)
-    {
-      if (packet->stream_index == _videoStreamIndex)
-      {
-        avcodec_send_packet(_codecContext.get(), packet);
-        av_packet_unref(packet);
-
-        auto frame = av_frame_alloc();
-        int ret = avcodec_receive_frame(_codecContext.get(), frame);
-
-        if (ret == AVERROR(EAGAIN))
-        {
-          // pass
-        }
-        else if (ret == 0)
-        {
-          auto swsContext = sws_getContext(
-            width(),
-            height(),
-            _codecContext.get()->pix_fmt,
-            width(),
-            height(),
-            AV_PIX_FMT_RGBA,
-            SWS_BILINEAR,
-            nullptr,
-            nullptr,
-            nullptr);
-          int linesize = width() * 4;
-          auto data = reinterpret_cast<uint8_t* const>(buffer.data());
-          sws_scale(swsContext, frame->data, frame->linesize, 0, height(), &data, &linesize);
-
-          sws_freeContext(swsContext);
-          break;
-        }
-        else
-        {
-          // error
-          break;
-        }
-        av_frame_free(&frame);
-      }
-      av_packet_unref(packet);
-    }
-
-    av_packet_free(&packet);
-
-    return buffer;
-  }
-
-  int width() const
-  {
-    return _codecContext.get()->width;
-  }
-
-  int height() const
-  {
-    return _codecContext.get()->height;
-  }
-
-  void destroy()
-  {
-    {
-      auto cc = _codecContext.release();
-      avcodec_free_context(&cc);
-    }
-    {
-      auto fc = _formatContext.release();
-      avformat_close_input(&fc);
-      avformat_free_context(fc);
-    }
-  }
-
-private:
-  std::unique_ptr<AVFormatContext> _formatContext;
-  std::unique_ptr<AVCodecContext> _codecContext;
-  int _videoStreamIndex = -1;
-};
-
-}}} // namespace daia::player::media
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "../../util/trace.hpp"
+#include "../common/pixel_format.hpp"
+#include "ffmpeg.hpp"
+#include "frame_index.hpp"
+#include "read_ahead.hpp"
+
+namespace daia { namespace player { namespace media {
+
+class Video
+{
+public:
+  static constexpr int64_t unindexedSeekDistance = 300; // frames decoded forward from a known keyframe at most, without a demuxer index
+
+  // threadCount: decoder threads. 0 lets libavcodec pick one per core
+  // readAhead: the demuxer reads through a ReadAhead window unless its size is 0
+  // cancel: setting it from another thread makes opening fail at the next read. must outlive the Video
+  bool setup(const std::filesystem::path& filepath, int threadCount = 1, ReadAheadOptions readAhead = {}, const std::atomic<bool>* cancel = nullptr)
+  {
+    _threadCount = threadCount;
+
+    {
+      AVFormatContext* fc = avformat_alloc_context();
+      if (cancel)
+      {
+        fc->interrupt_callback = {
+          .callback = &Video::_interrupted,
+          .opaque = const_cast<std::atomic<bool>*>(cancel),
+        };
+      }
+      if (readAhead.window > 0)
+      {
+        _readAhead = std::make_unique<ReadAhead>();
+        if (!_readAhead->open(filepath, readAhead))
+        {
+          avformat_free_context(fc);
+          _readAhead.reset();
+          fprintf(stderr, "Could not open input file.\n");
+          return false;
+        }
+        fc->pb = _readAhead->context();
+        fc->flags |= AVFMT_FLAG_CUSTOM_IO;
+      }
+      // frees fc on failure
+      if (avformat_open_input(&fc, reinterpret_cast<const char*>(filepath.u8string().c_str()), nullptr, nullptr) != 0)
+      {
+        fprintf(stderr, "Could not open input file.\n");
+        return false;
+      }
+      _formatContext = FormatContext(fc);
+    }
+
+    if (avformat_find_stream_info(_formatContext.get(), nullptr) < 0)
+    {
+      fprintf(stderr, "Failed to retrieve stream info.\n");
+      return false;
+    }
+
+    for (int i = 0; i < _formatContext->nb_streams; i++)
+    {
+      if (_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+      {
+        _videoStreamIndex = i;
+        break;
+      }
+    }
+
+    if (_videoStreamIndex < 0)
+    {
+      fprintf(stderr, "Failed to find video stream\n");
+      return false;
+    }
+
+    if (!_openCodec())
+    {
+      return false;
+    }
+
+    if (!_index.build(_formatContext.get(), _videoStreamIndex))
+    {
+      fprintf(stderr, "Failed to build frame index\n");
+      return false;
+    }
+
+    _selectOutputFormat();
+
+    _packet = makePacket();
+    _current = makeFrame();
+    _nextFrame = 0;
+    _currentFrame = -1;
+
+    return true;
+  }
+
+  // reopens the codec with another number of threads. call after seek() or once the codec is drained;
+  // decoding continues from the next packet sent
+  // on failure the codec in use stays, flushed so it decodes the packets sent next
+  bool setThreadCount(int threadCount)
+  {
+    if (threadCount == _threadCount)
+    {
+      return true;
+    }
+    const auto previous = _threadCount;
+    _threadCount = threadCount;
+    if (!_openCodec())
+    {
+      _threadCount = previous;
+      avcodec_flush_buffers(_codecContext.get());
+      _draining = false;
+      return false;
+    }
+    return true;
+  }
+
+  // whether a fresh codec can start decoding at packet: no frame from it on references one before it.
+  // open-GOP keyframes (H.264 recovery points, HEVC CRA, MPEG-2 and MPEG-4 GOPs) do not qualify,
+  // their leading frames would decode from references the new codec never saw
+  bool isRestartPoint(const AVPacket* packet) const
+  {
+    if (!(packet->flags & AV_PKT_FLAG_KEY))
+    {
+      return false;
+    }
+    switch (_formatContext->streams[_videoStreamIndex]->codecpar->codec_id)
+    {
+      case AV_CODEC_ID_H264:
+        // IDR slice
+        return _hasNalUnit(packet, [](uint8_t header) { return (header & 0x1f) == 5; });
+      case AV_CODEC_ID_HEVC:
+      {
+        // IDR_W_RADL and IDR_N_LP. leading RADL frames only reference the IDR
+        return _hasNalUnit(packet, [](uint8_t header) {
+          const auto type = (header >> 1) & 0x3f;
+          return type == 19 || type == 20;
+        });
+      }
+      case AV_CODEC_ID_VP8:
+      case AV_CODEC_ID_VP9:
+      case AV_CODEC_ID_AV1:
+      case AV_CODEC_ID_MJPEG:
+      case AV_CODEC_ID_PRORES:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  int threadCount() const
+  {
+    return _threadCount;
+  }
+
+  // decode work of one frame relative to a 1080p H.264 frame. reads only the stream parameters, so it is safe while
+  // the decoding thread reopens the codec
+  double decodeCost() const
+  {
+    const auto codecId = _formatContext->streams[_videoStreamIndex]->codecpar->codec_id;
+    const auto* codec = avcodec_find_decoder(codecId);
+    const auto lowres = codec ? std::min(_decodeScale, static_cast<int>(codec->max_lowres)) : 0;
+    double codecCost = 1;
+    switch (codecId)
+    {
+      case AV_CODEC_ID_MPEG2VIDEO:
+      case AV_CODEC_ID_MPEG4:
+      case AV_CODEC_ID_MJPEG:
+        codecCost = 0.5;
+        break;
+      case AV_CODEC_ID_PRORES:
+        codecCost = 0.7;
+        break;
+      case AV_CODEC_ID_HEVC:
+      case AV_CODEC_ID_VP9:
+        codecCost = 1.5;
+        break;
+      case AV_CODEC_ID_AV1:
+        codecCost = 2;
+        break;
+      default:
+        break;
+    }
+    // each lowres step decodes a quarter of the pixels
+    return codecCost * width() * height() / (1920.0 * 1080.0) / (1 << (2 * lowres));
+  }
+
+  // demux: reads the next packet of the video stream. returns false at the end of the file
+  bool readPacket(AVPacket* packet)
+  {
+    DAIA_TRACE_SCOPE("av_read_frame");
+    while (av_read_frame(_formatContext.get(), packet) >= 0)
+    {
+      if (packet->stream_index == _videoStreamIndex)
+      {
+        if ((packet->flags & AV_PKT_FLAG_KEY) && packet->pts != AV_NOPTS_VALUE)
+        {
+          _index.addKeyframe(packet->pts, packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts);
+        }
+        return true;
+      }
+      av_packet_unref(packet);
+    }
+    return false;
+  }
+
+  // decode: nullptr packet starts draining the decoder
+  int sendPacket(const AVPacket* packet)
+  {
+    DAIA_TRACE_SCOPE("avcodec_send_packet");
+    return avcodec_send_packet(_codecContext.get(), packet);
+  }
+
+  int receiveFrame(AVFrame* frame)
+  {
+    DAIA_TRACE_SCOPE("avcodec_receive_frame");
+    return avcodec_receive_frame(_codecContext.get(), frame);
+  }
+
+  // convert: writes the frame into dst laid out as outputLayout()
+  void convert(const AVFrame* frame, uint8_t* dst)
+  {
+    convert(frame, dst, width(), height());
+  }
+
+  // planar output of the decoded size needs no conversion: its planes are copied as they are by copyPlanes()
+  bool copiesPlanes(const AVFrame* frame, int dstWidth, int dstHeight) const
+  {
+    return _outputFormat != common::PixelFormat::eRGBA8 && frame->width == dstWidth && frame->height == dstHeight
+      && toAVPixelFormat(_outputFormat) == _planarSource(static_cast<AVPixelFormat>(frame->format));
+  }
+
+  // writes the planes of a frame for which copiesPlanes() holds into dst laid out as outputLayout(frame->width, frame->height)
+  void copyPlanes(const AVFrame* frame, uint8_t* dst) const
+  {
+    DAIA_TRACE_SCOPE("Video::copyPlanes");
+    const auto layout = outputLayout(frame->width, frame->height);
+    for (uint32_t i = 0; i < layout.count; i++)
+    {
+      const auto& plane = layout.planes[i];
+      av_image_copy_plane(dst + plane.offset, static_cast<int>(plane.rowPitch()), frame->data[i], frame->linesize[i], plane.rowPitch(), plane.height);
+    }
+  }
+
+  // writes the frame scaled to dstWidth x dstHeight into dst laid out as outputLayout(dstWidth, dstHeight).
+  // planar output of the decoded size copies the decoded planes as they are; sws_scale is used for other formats and sizes
+  void convert(const AVFrame* frame, uint8_t* dst, int dstWidth, int dstHeight)
+  {
+    if (copiesPlanes(frame, dstWidth, dstHeight))
+    {
+      copyPlanes(frame, dst);
+      return;
+    }
+
+    DAIA_TRACE_SCOPE("Video::convert");
+    const auto layout = outputLayout(dstWidth, dstHeight);
+    std::array<uint8_t*, 4> dstData = {};
+    std::array<int, 4> dstLinesize = {};
+    for (uint32_t i = 0; i < layout.count; i++)
+    {
+      dstData[i] = dst + layout.planes[i].offset;
+      dstLinesize[i] = static_cast<int>(layout.planes[i].rowPitch());
+    }
+
+    const auto srcFormat = static_cast<AVPixelFormat>(frame->format);
+    const auto key = ScaleKey{
+      .format = srcFormat,
+      .width = frame->width,
+      .height = frame->height,
+      .dstWidth = dstWidth,
+      .dstHeight = dstHeight,
+    };
+    if (!_swsContext || key != _scaleKey)
+    {
+      // area averaging keeps large downscales from aliasing
+      const auto flags = dstWidth * 2 <= key.width || dstHeight * 2 <= key.height ? SWS_AREA : SWS_BILINEAR;
+      _swsContext = ScaleContext(sws_getContext(
+        key.width,
+        key.height,
+        key.format,
+        dstWidth,
+        dstHeight,
+        toAVPixelFormat(_outputFormat),
+        flags,
+        nullptr,
+        nullptr,
+        nullptr));
+      _scaleKey = key;
+    }
+    sws_scale(_swsContext.get(), frame->data, frame->linesize, 0, key.height, dstData.data(), dstLinesize.data());
+  }
+
+  static AVPixelFormat toAVPixelFormat(common::PixelFormat format)
+  {
+    switch (format)
+    {
+      case common::PixelFormat::eYUV420P:
+        return AV_PIX_FMT_YUV420P;
+      case common::PixelFormat::eNV12:
+        return AV_PIX_FMT_NV12;
+      default:
+        return AV_PIX_FMT_RGBA;
+    }
+  }
+
+  // RGBA forces the CPU conversion even for planar sources
+  void setOutputFormat(common::PixelFormat format)
+  {
+    _outputFormat = format;
+    _swsContext.reset();
+  }
+
+  common::PixelFormat outputFormat() const
+  {
+    return _outputFormat;
+  }
+
+  common::PlaneLayout outputLayout() const
+  {
+    return outputLayout(width(), height());
+  }
+
+  common::PlaneLayout outputLayout(int width, int height) const
+  {
+    return common::planeLayout(_outputFormat, width, height);
+  }
+
+  common::ColorSpace colorSpace() const
+  {
+    return _colorSpace;
+  }
+
+  // moves the demuxer to the keyframe before frame and resets the decoder.
+  // returns the earliest pts of frame; frames presented before it should be dropped
+  int64_t seek(int64_t frame)
+  {
+    DAIA_TRACE_SCOPE("Video::seek");
+    const auto keyframe = _index.keyframeBefore(frame);
+    avcodec_flush_buffers(_codecContext.get());
+    _draining = false;
+    _currentFrame = -1;
+    if (!_index.indexed() && frame - keyframe.frame > unindexedSeekDistance)
+    {
+      // files without an index only know the keyframes played so far. a far target is left to the demuxer's timestamp search
+      av_seek_frame(_formatContext.get(), _videoStreamIndex, _index.earliestPts(frame), AVSEEK_FLAG_BACKWARD);
+      _nextFrame = frame;
+      return _index.earliestPts(frame);
+    }
+    av_seek_frame(_formatContext.get(), _videoStreamIndex, keyframe.dts, AVSEEK_FLAG_BACKWARD);
+    _nextFrame = keyframe.frame;
+    return _index.earliestPts(frame);
+  }
+
+  std::vector<uint8_t> getFrame(int64_t frame)
+  {
+    std::vector<uint8_t> buffer(outputLayout().size);
+    getFrame(frame, buffer);
+    return buffer;
+  }
+
+  // writes frame into a caller owned buffer of outputLayout().size bytes
+  bool getFrame(int64_t frame, std::span<uint8_t> dst)
+  {
+    if (dst.size() < outputLayout().size || !decodeFrame(frame))
+    {
+      return false;
+    }
+    convert(_current.get(), dst.data());
+    return true;
+  }
+
+  // decodes frame into currentFrame().
+  // a request for the next frame (or one before the next keyframe) keeps decoding sequentially,
+  // anything else seeks to the nearest preceding keyframe first
+  bool decodeFrame(int64_t frame)
+  {
+    if (frameCount() == 0)
+    {
+      return false;
+    }
+    frame = std::clamp<int64_t>(frame, 0, frameCount() - 1);
+
+    if (frame == _currentFrame)
+    {
+      return true;
+    }
+
+    if (frame < _nextFrame || _index.keyframeBefore(frame).frame > _nextFrame)
+    {
+      seek(frame);
+    }
+
+    if (!_decodeUntil(_index.earliestPts(frame)))
+    {
+      return false;
+    }
+
+    _currentFrame = _index.frameAt(_current->best_effort_timestamp);
+    _nextFrame = _currentFrame + 1;
+    return true;
+  }
+
+  const AVFrame* currentFrame() const
+  {
+    return _current.get();
+  }
+
+  int64_t frameCount() const
+  {
+    return _index.frameCount();
+  }
+
+  int64_t frameAt(int64_t pts) const
+  {
+    return _index.frameAt(pts);
+  }
+
+  int64_t frameAtTime(double seconds) const
+  {
+    const auto stream = _formatContext->streams[_videoStreamIndex];
+    const auto start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    return _index.frameAt(start + static_cast<int64_t>(seconds / av_q2d(stream->time_base)));
+  }
+
+  // of the stream. lowres decoding outputs smaller frames
+  int width() const
+  {
+    return _formatContext->streams[_videoStreamIndex]->codecpar->width;
+  }
+
+  int height() const
+  {
+    return _formatContext->streams[_videoStreamIndex]->codecpar->height;
+  }
+
+  // reopens the codec to decode with less quality for output downscaled by 2^scale or more.
+  // 1 skips the loop filter of frames no other frame references, 2 and up skip it for all frames,
+  // and decoders that support lowres decode at 1/2^scale of the size. decoding continues after the next seek()
+  bool setDecodeScale(int scale)
+  {
+    if (scale == _decodeScale)
+    {
+      return true;
+    }
+    const auto previous = _decodeScale;
+    _decodeScale = scale;
+    if (!_openCodec())
+    {
+      // the codec in use stays
+      _decodeScale = previous;
+      return false;
+    }
+    return true;
+  }
+
+  int decodeScale() const
+  {
+    return _decodeScale;
+  }
+
+  AVRational timeBase() const
+  {
+    return _formatContext->streams[_videoStreamIndex]->time_base;
+  }
+
+  void destroy()
+  {
+    _swsContext.reset();
+    _current.reset();
+    _packet.reset();
+    _codecContext.reset();
+    _formatContext.reset();
+    _readAhead.reset();
+    _videoStreamIndex = -1;
+  }
+
+  // empty when the file is read through libavformat's own I/O
+  ReadAheadStats readAheadStats() const
+  {
+    return _readAhead ? _readAhead->stats() : ReadAheadStats{};
+  }
+
+private:
+  static int _interrupted(void* opaque)
+  {
+    return static_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+  }
+
+  // formats with the same memory layout as a planar output format
+  static AVPixelFormat _planarSource(AVPixelFormat format)
+  {
+    return format == AV_PIX_FMT_YUVJ420P ? AV_PIX_FMT_YUV420P : format;
+  }
+
+  // frame threading when the codec supports it, else slice threading
+  // replaces the codec only once the new one is open
+  bool _openCodec()
+  {
+    const auto videoStream = _formatContext->streams[_videoStreamIndex];
+    auto codec = avcodec_find_decoder(videoStream->codecpar->codec_id);
+    auto context = CodecContext(avcodec_alloc_context3(codec));
+    if (!context)
+    {
+      fprintf(stderr, "Failed to allocate codec context\n");
+      return false;
+    }
+    avcodec_parameters_to_context(context.get(), videoStream->codecpar);
+    context->thread_count = _threadCount;
+    context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    context->lowres = codec ? std::min(_decodeScale, static_cast<int>(codec->max_lowres)) : 0;
+    context->skip_loop_filter = _decodeScale >= 2 ? AVDISCARD_ALL : _decodeScale == 1 ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    if (avcodec_open2(context.get(), codec, nullptr) < 0)
+    {
+      fprintf(stderr, "Failed to open codec\n");
+      return false;
+    }
+    _codecContext = std::move(context);
+    _draining = false;
+    return true;
+  }
+
+  // calls predicate with the header byte of each NAL unit of an H.264 or HEVC packet until it returns true.
+  // packets are length prefixed as in mp4 and mkv when the extradata is an avcC/hvcC record, Annex B otherwise
+  template <typename Predicate>
+  bool _hasNalUnit(const AVPacket* packet, Predicate predicate) const
+  {
+    const auto* parameters = _formatContext->streams[_videoStreamIndex]->codecpar;
+    const auto* data = packet->data;
+    const int64_t size = packet->size;
+    const auto lengthSizeOffset = parameters->codec_id == AV_CODEC_ID_HEVC ? 21 : 4;
+    if (parameters->extradata_size > lengthSizeOffset && parameters->extradata[0] == 1)
+    {
+      const auto lengthSize = (parameters->extradata[lengthSizeOffset] & 3) + 1;
+      for (int64_t pos = 0; pos + lengthSize < size;)
+      {
+        int64_t length = 0;
+        for (int i = 0; i < lengthSize; i++)
+        {
+          length = (length << 8) | data[pos + i];
+        }
+        pos += lengthSize;
+        if (predicate(data[pos]))
+        {
+          return true;
+        }
+        pos += length;
+      }
+      return false;
+    }
+    for (int64_t pos = 0; pos + 3 < size; pos++)
+    {
+      if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1)
+      {
+        if (predicate(data[pos + 3]))
+        {
+          return true;
+        }
+        pos += 2;
+      }
+    }
+    return false;
+  }
+
+  void _selectOutputFormat()
+  {
+    switch (_planarSource(_codecContext->pix_fmt))
+    {
+      case AV_PIX_FMT_YUV420P:
+        _outputFormat = common::PixelFormat::eYUV420P;
+        break;
+      case AV_PIX_FMT_NV12:
+        _outputFormat = common::PixelFormat::eNV12;
+        break;
+      default:
+        _outputFormat = common::PixelFormat::eRGBA8;
+        break;
+    }
+
+    switch (_codecContext->colorspace)
+    {
+      case AVCOL_SPC_BT709:
+        _colorSpace.matrix = common::ColorMatrix::eBT709;
+        break;
+      case AVCOL_SPC_BT470BG:
+      case AVCOL_SPC_SMPTE170M:
+        _colorSpace.matrix = common::ColorMatrix::eBT601;
+        break;
+      default:
+        // unspecified: SD content is usually BT.601
+        _colorSpace.matrix = height() < 720 ? common::ColorMatrix::eBT601 : common::ColorMatrix::eBT709;
+        break;
+    }
+    _colorSpace.fullRange = _codecContext->color_range == AVCOL_RANGE_JPEG || _codecContext->pix_fmt == AV_PIX_FMT_YUVJ420P;
+  }
+
+  struct ScaleKey
+  {
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    int width = 0;
+    int height = 0;
+    int dstWidth = 0;
+    int dstHeight = 0;
+
+    bool operator==(const ScaleKey&) const = default;
+  };
+
+  // decodes forward until a frame presented at or after pts
+  bool _decodeUntil(int64_t pts)
+  {
+    while (true)
+    {
+      const auto ret = receiveFrame(_current.get());
+      if (ret == 0)
+      {
+        const auto framePts = _current->best_effort_timestamp;
+        if (framePts == AV_NOPTS_VALUE || framePts >= pts)
+        {
+          return true;
+        }
+        continue;
+      }
+      if (ret != AVERROR(EAGAIN))
+      {
+        return false;
+      }
+
+      if (readPacket(_packet.get()))
+      {
+        sendPacket(_packet.get());
+        av_packet_unref(_packet.get());
+      }
+      else if (!_draining)
+      {
+        sendPacket(nullptr);
+        _draining = true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+  }
+
+  std::unique_ptr<ReadAhead> _readAhead; // destroyed after the format context reading through it
+  FormatContext _formatContext;
+  CodecContext _codecContext;
+  int _videoStreamIndex = -1;
+
+  FrameIndex _index;
+  Packet _packet;
+  Frame _current;
+  int64_t _nextFrame = 0;
+  int64_t _currentFrame = -1;
+  bool _draining = false;
+  int _threadCount = 1;
+  int _decodeScale = 0;
+
+  common::PixelFormat _outputFormat = common::PixelFormat::eRGBA8;
+  common::ColorSpace _colorSpace;
+  ScaleContext _swsContext;
+  ScaleKey _scaleKey;
+};
+
+}}} // namespace daia::player::media
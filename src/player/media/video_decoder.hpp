@@ -0,0 +1,612 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../../util/bounded_queue.hpp"
+#include "../../util/pool.hpp"
+#include "../../util/util.hpp"
+#include "decode_scheduler.hpp"
+#include "ffmpeg.hpp"
+#include "video.hpp"
+
+namespace daia { namespace player { namespace media {
+
+struct DecodedFrame
+{
+  int64_t pts = AV_NOPTS_VALUE;
+  std::vector<uint8_t> data; // laid out as Video::outputLayout(width, height)
+  Frame frame;               // decoded frame not converted yet. set instead of data for planar output of the decoded size
+  int width = 0;             // output size the frame is or will be converted to
+  int height = 0;
+};
+
+// Runs demux -> decode -> convert of one Video as tasks on a DecodeScheduler shared with the other decoders.
+//   demux   : Video::readPacket  -> packet queue
+//   decode  : packet queue       -> Video::sendPacket/receiveFrame -> frame queue
+//   convert : frame queue        -> Video::convert                 -> output queue
+// A step runs until its output queue is full or its input is empty and never blocks a worker.
+// Taking items out of a queue schedules the step that fills it, adding items schedules the step that drains it.
+// Each step runs on at most one worker at a time; different steps of one stream may run in parallel.
+// Tasks carry the stream's deadline, so workers serve the streams closest to missing a frame first.
+// The render thread only takes finished frames with tryPop(), copies them out with write() and gives the buffers back with recycle().
+// Planar output of the decoded size skips the conversion: the decoded frame is passed through and its planes are copied
+// by write(), usually straight into mapped staging memory, so the pixels are copied once instead of twice.
+// Planar frames of another size are scaled in the convert step like RGBA ones, so write() never scales on the render thread.
+// Frames are scaled to the output size set when they reach the convert step. Each frame records that size,
+// so frames converted before a resize stay consistent with their own layout.
+// Packets, frames and pixel buffers are recycled through pools, so steady-state playback does not allocate.
+class VideoDecoder
+{
+public:
+  static constexpr size_t packetQueueSize = 32;
+  static constexpr size_t frameQueueSize = 4;
+  static constexpr size_t outputQueueSize = 3;
+  static constexpr size_t packetsPerStep = 8; // demux reads in short steps so one stream does not hold a worker
+
+  explicit VideoDecoder(DecodeScheduler& scheduler = DecodeScheduler::shared())
+    : _packets(packetQueueSize)
+    , _frames(frameQueueSize)
+    , _output(outputQueueSize)
+    , _packetPool(packetQueueSize + 1)
+    , _framePool(frameQueueSize + outputQueueSize + 2)
+    , _bufferPool(outputQueueSize + 2)
+    , _scheduler(scheduler)
+  {
+  }
+
+  ~VideoDecoder()
+  {
+    stop();
+  }
+
+  VideoDecoder(const VideoDecoder&) = delete;
+  VideoDecoder& operator=(const VideoDecoder&) = delete;
+
+  bool setup(const std::filesystem::path& filepath, ReadAheadOptions readAhead = {}, const std::atomic<bool>* cancel = nullptr)
+  {
+    return _video.setup(filepath, 1, readAhead, cancel);
+  }
+
+  void start()
+  {
+    {
+      std::lock_guard lock(_taskMutex);
+      if (_running)
+      {
+        return;
+      }
+
+      _packets.reopen();
+      _frames.reopen();
+      _output.reopen();
+      _receiving = false;
+      _draining = false;
+      _reopening = false;
+      if (_heldPacket)
+      {
+        av_packet_unref(_heldPacket->get());
+        _packetPool.release(std::move(*_heldPacket));
+        _heldPacket.reset();
+      }
+      // decoding restarts at a seek point, so a pending thread count applies now
+      _applyThreadCount();
+
+      _running = true;
+      _stopping = false;
+    }
+    _schedule(Step::eDemux);
+  }
+
+  // waits for the steps being run. steps queued on the scheduler return without doing anything
+  void stop()
+  {
+    {
+      std::lock_guard lock(_taskMutex);
+      if (!_running)
+      {
+        return;
+      }
+      _stopping = true;
+    }
+
+    _packets.close();
+    _frames.close();
+    _output.close();
+
+    std::unique_lock lock(_taskMutex);
+    _idle.wait(lock, [this] { return _activeTasks == 0; });
+    _running = false;
+  }
+
+  void destroy()
+  {
+    stop();
+    _video.destroy();
+  }
+
+  // frees the queued frames and the pooled packets, frames and pixel buffers. call while stopped
+  void releaseBuffers()
+  {
+    _packets.clear();
+    _frames.clear();
+    _output.clear();
+    _packetPool.clear();
+    _framePool.clear();
+    _bufferPool.clear();
+  }
+
+  // restarts decoding at frame. frames queued for the old position are discarded
+  void seek(int64_t frame)
+  {
+    stop();
+    _skipUntil = _video.seek(frame);
+    start();
+  }
+
+  std::optional<DecodedFrame> tryPop()
+  {
+    auto frame = _output.tryPop();
+    if (frame)
+    {
+      _schedule(Step::eConvert);
+    }
+    return frame;
+  }
+
+  // blocks until a frame is ready. nullopt once every frame has been taken or the decoder is stopped
+  std::optional<DecodedFrame> pop()
+  {
+    auto frame = _output.pop();
+    if (frame)
+    {
+      _schedule(Step::eConvert);
+    }
+    return frame;
+  }
+
+  // global time the next frame is needed by. streams with earlier deadlines are decoded first
+  void setDeadline(double deadline)
+  {
+    _deadline = deadline;
+  }
+
+  // writes a frame taken by tryPop() into dst laid out as Video::outputLayout(frame.width, frame.height)
+  // false when dst is smaller than that layout, e.g. staging sized before a resize. nothing is written then
+  bool write(const DecodedFrame& frame, std::span<uint8_t> dst)
+  {
+    const auto size = _video.outputLayout(frame.width, frame.height).size;
+    if (dst.size() < size)
+    {
+      return false;
+    }
+    if (frame.frame)
+    {
+      _video.copyPlanes(frame.frame.get(), dst.data());
+    }
+    else
+    {
+      std::memcpy(dst.data(), frame.data.data(), std::min(size, frame.data.size()));
+    }
+    return true;
+  }
+
+  // gives a frame taken by tryPop() back for reuse
+  void recycle(DecodedFrame&& frame)
+  {
+    if (!frame.data.empty())
+    {
+      _bufferPool.release(std::move(frame.data));
+    }
+    if (frame.frame)
+    {
+      av_frame_unref(frame.frame.get());
+      _framePool.release(std::move(frame.frame));
+    }
+  }
+
+  // all frames of the file have been taken
+  bool finished() const
+  {
+    return _output.closed() && _output.size() == 0;
+  }
+
+  int width() const
+  {
+    return _video.width();
+  }
+
+  int height() const
+  {
+    return _video.height();
+  }
+
+  AVRational timeBase() const
+  {
+    return _video.timeBase();
+  }
+
+  // codec threads. a running decoder switches at the next keyframe that nothing after it references from before
+  // (see Video::isRestartPoint), once the frames before it are drained, so playback goes on without a seek.
+  // safe while decoding
+  void setThreadCount(int threadCount)
+  {
+    _threadCount = threadCount;
+  }
+
+  // the count set last, which the codec may not use yet
+  int threadCount() const
+  {
+    return _threadCount;
+  }
+
+  ReadAheadStats readAheadStats() const
+  {
+    return _video.readAheadStats();
+  }
+
+  double decodeCost() const
+  {
+    return _video.decodeCost();
+  }
+
+  // size frames reaching the convert step from now on are scaled to. 0 keeps the size of the stream.
+  // safe while decoding
+  void setOutputSize(int width, int height)
+  {
+    _outputSize = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+  }
+
+  util::uint2 outputSize() const
+  {
+    const auto size = _outputSize.load();
+    return { size[0] > 0 ? size[0] : static_cast<uint32_t>(width()), size[1] > 0 ? size[1] : static_cast<uint32_t>(height()) };
+  }
+
+  // call while stopped. decoding continues after the next seek()
+  bool setDecodeScale(int scale)
+  {
+    return _video.setDecodeScale(scale);
+  }
+
+  int decodeScale() const
+  {
+    return _video.decodeScale();
+  }
+
+  // call before start()
+  void setOutputFormat(common::PixelFormat format)
+  {
+    _video.setOutputFormat(format);
+  }
+
+  common::PixelFormat outputFormat() const
+  {
+    return _video.outputFormat();
+  }
+
+  common::PlaneLayout outputLayout() const
+  {
+    const auto [w, h] = outputSize();
+    return _video.outputLayout(static_cast<int>(w), static_cast<int>(h));
+  }
+
+  common::ColorSpace colorSpace() const
+  {
+    return _video.colorSpace();
+  }
+
+  int64_t frameCount() const
+  {
+    return _video.frameCount();
+  }
+
+  int64_t frameAt(int64_t pts) const
+  {
+    return _video.frameAt(pts);
+  }
+
+  int64_t frameAtTime(double seconds) const
+  {
+    return _video.frameAtTime(seconds);
+  }
+
+private:
+  enum class Step
+  {
+    eDemux,
+    eDecode,
+    eConvert,
+  };
+
+  enum class StepState
+  {
+    eIdle,
+    eQueued,   // submitted or running
+    eRunAgain, // running and scheduled again meanwhile: submitted once more when it returns
+  };
+
+  void _schedule(Step step)
+  {
+    std::lock_guard lock(_taskMutex);
+    if (!_running || _stopping)
+    {
+      return;
+    }
+    auto& state = _stepStates[static_cast<size_t>(step)];
+    if (state == StepState::eIdle)
+    {
+      state = StepState::eQueued;
+      _activeTasks++;
+      _submit(step);
+    }
+    else
+    {
+      state = StepState::eRunAgain;
+    }
+  }
+
+  // call with _taskMutex held
+  void _submit(Step step)
+  {
+    _scheduler.submit({
+      .deadline = _deadline,
+      .run = [this, step] { _run(step); },
+    });
+  }
+
+  void _run(Step step)
+  {
+    auto& state = _stepStates[static_cast<size_t>(step)];
+    {
+      std::lock_guard lock(_taskMutex);
+      state = StepState::eQueued;
+    }
+
+    if (!_stopping)
+    {
+      switch (step)
+      {
+        case Step::eDemux:
+          _demux();
+          break;
+        case Step::eDecode:
+          _decode();
+          break;
+        case Step::eConvert:
+          _convert();
+          break;
+      }
+    }
+
+    std::lock_guard lock(_taskMutex);
+    if (state == StepState::eRunAgain && !_stopping)
+    {
+      state = StepState::eQueued;
+      _submit(step);
+      return;
+    }
+    state = StepState::eIdle;
+    if (--_activeTasks == 0)
+    {
+      _idle.notify_all();
+    }
+  }
+
+  void _demux()
+  {
+    if (_packets.closed())
+    {
+      return;
+    }
+    for (size_t i = 0; i < packetsPerStep && !_packets.full(); i++)
+    {
+      auto packet = _packetPool.acquire(makePacket);
+      if (!_video.readPacket(packet.get()))
+      {
+        _packetPool.release(std::move(packet));
+        _packets.close();
+        _schedule(Step::eDecode);
+        return;
+      }
+      // the only producer: there is room
+      _packets.push(std::move(packet));
+    }
+    _schedule(Step::eDecode);
+    if (!_packets.full())
+    {
+      // more to read. queued again behind the other streams' work
+      _schedule(Step::eDemux);
+    }
+  }
+
+  void _decode()
+  {
+    if (_frames.closed())
+    {
+      return;
+    }
+    while (true)
+    {
+      // frames of the last packet sent come first
+      if (_receiving)
+      {
+        if (!_receiveFrames())
+        {
+          // frame queue full. convert schedules this step again when it takes a frame
+          return;
+        }
+        _receiving = false;
+        if (_reopening)
+        {
+          // every frame before the keyframe is out: the new codec starts with it
+          _applyThreadCount();
+          _reopening = false;
+        }
+      }
+
+      // closed is read first: the demuxer closes the queue only after its last push
+      const auto closed = _packets.closed();
+      auto packet = _heldPacket ? std::exchange(_heldPacket, std::nullopt) : _packets.tryPop();
+      if (!packet)
+      {
+        if (!closed)
+        {
+          return;
+        }
+        if (!_draining)
+        {
+          // end of file: drain frames buffered in the decoder
+          _video.sendPacket(nullptr);
+          _draining = true;
+          _receiving = true;
+          continue;
+        }
+        _frames.close();
+        _schedule(Step::eConvert);
+        return;
+      }
+      _schedule(Step::eDemux);
+
+      if (_threadCount != _video.threadCount() && _video.isRestartPoint(packet->get()))
+      {
+        // the codec is reopened with the new thread count at this keyframe. drain the old one first
+        _video.sendPacket(nullptr);
+        _heldPacket = std::move(packet);
+        _reopening = true;
+        _receiving = true;
+        continue;
+      }
+
+      const auto ret = _video.sendPacket(packet->get());
+      av_packet_unref(packet->get());
+      _packetPool.release(std::move(*packet));
+      _receiving = ret >= 0;
+    }
+  }
+
+  // reopens the codec with the thread count set last. call while stopped or once the codec is drained.
+  // if the codec cannot be reopened the stream goes on with the one it has
+  void _applyThreadCount()
+  {
+    if (!_video.setThreadCount(_threadCount))
+    {
+      fprintf(stderr, "Failed to reopen codec with %d threads\n", _threadCount.load());
+      _threadCount = _video.threadCount();
+    }
+  }
+
+  // false when the frame queue filled up before the decoder ran out of frames
+  bool _receiveFrames()
+  {
+    while (true)
+    {
+      if (_frames.full())
+      {
+        return false;
+      }
+
+      auto frame = _framePool.acquire(makeFrame);
+      const auto ret = _video.receiveFrame(frame.get());
+      if (ret < 0)
+      {
+        // EAGAIN, EOF or a decode error: nothing more for this packet
+        _framePool.release(std::move(frame));
+        return true;
+      }
+      if (frame->best_effort_timestamp != AV_NOPTS_VALUE && frame->best_effort_timestamp < _skipUntil)
+      {
+        // decoded from the keyframe but before the seek target
+        av_frame_unref(frame.get());
+        _framePool.release(std::move(frame));
+        continue;
+      }
+      _frames.push(std::move(frame));
+      _schedule(Step::eConvert);
+    }
+  }
+
+  void _convert()
+  {
+    while (!_output.closed() && !_output.full())
+    {
+      const auto closed = _frames.closed();
+      auto frame = _frames.tryPop();
+      if (!frame)
+      {
+        if (closed)
+        {
+          _output.close();
+        }
+        return;
+      }
+      _schedule(Step::eDecode);
+
+      const auto [w, h] = outputSize();
+      auto decoded = DecodedFrame{
+        .pts = (*frame)->best_effort_timestamp,
+        .width = static_cast<int>(w),
+        .height = static_cast<int>(h),
+      };
+      if (_video.copiesPlanes(frame->get(), decoded.width, decoded.height))
+      {
+        // planes are copied as they are by write(). keep the decoder's reference until recycle()
+        decoded.frame = std::move(*frame);
+      }
+      else
+      {
+        const auto size = _video.outputLayout(decoded.width, decoded.height).size;
+        decoded.data = _bufferPool.acquire([size] { return std::vector<uint8_t>(size); });
+        decoded.data.resize(size);
+        _video.convert(frame->get(), decoded.data.data(), decoded.width, decoded.height);
+
+        // the decoder keeps its own buffer pool for the frame data; unref returns it
+        av_frame_unref(frame->get());
+        _framePool.release(std::move(*frame));
+      }
+
+      _output.push(std::move(decoded));
+    }
+  }
+
+  Video _video;
+  int64_t _skipUntil = AV_NOPTS_VALUE;
+
+  util::BoundedQueue<Packet> _packets;
+  util::BoundedQueue<Frame> _frames;
+  util::BoundedQueue<DecodedFrame> _output;
+
+  util::Pool<Packet> _packetPool;
+  util::Pool<Frame> _framePool;
+  util::Pool<std::vector<uint8_t>> _bufferPool;
+
+  DecodeScheduler& _scheduler;
+  std::atomic<double> _deadline = 0;
+  std::atomic<util::uint2> _outputSize = util::uint2{}; // 0 keeps the stream size
+  std::atomic<int> _threadCount = 1;                    // codec threads to switch to at the next restart point
+
+  // step state, guarded by _taskMutex
+  std::mutex _taskMutex;
+  std::condition_variable _idle;
+  std::array<StepState, 3> _stepStates = {};
+  size_t _activeTasks = 0; // submitted or running steps
+  bool _running = false;
+  std::atomic<bool> _stopping = false;
+
+  // decode step state
+  bool _receiving = false;           // frames of the last packet sent may still be in the decoder
+  bool _draining = false;            // the end of the stream has been sent
+  bool _reopening = false;           // draining the codec before the thread count changes
+  std::optional<Packet> _heldPacket; // keyframe sent to the reopened codec
+};
+
+}}} // namespace daia::player::media
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+namespace daia { namespace player { namespace pipeline {
+
+enum class PresentPolicy : uint32_t
+{
+  eTearFree = 0,   // fifo. capped at the display rate, always available
+  eLowLatency = 1, // mailbox. the newest frame replaces the queued one without tearing
+  eUncapped = 2,   // immediate. for benchmarks, tears
+};
+
+// the first mode of the policy's preference list the surface supports. fifo is required by the spec, so it is the last resort
+inline vk::PresentModeKHR choosePresentMode(const std::vector<vk::PresentModeKHR>& available, PresentPolicy policy)
+{
+  std::vector<vk::PresentModeKHR> preferred;
+  switch (policy)
+  {
+    case PresentPolicy::eTearFree:
+      break;
+    case PresentPolicy::eLowLatency:
+      preferred = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+      break;
+    case PresentPolicy::eUncapped:
+      preferred = { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox };
+      break;
+  }
+
+  for (const auto mode : preferred)
+  {
+    if (std::find(available.begin(), available.end(), mode) != available.end())
+    {
+      return mode;
+    }
+  }
+  return vk::PresentModeKHR::eFifo;
+}
+
+// an 8 bit unorm format in sRGB color space. pane.frag writes display values, so srgb formats would encode them twice
+inline std::optional<vk::SurfaceFormatKHR> chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& available)
+{
+  if (available.empty())
+  {
+    return std::nullopt;
+  }
+
+  // a single undefined entry means any format is fine
+  if (available.size() == 1 && available.front().format == vk::Format::eUndefined)
+  {
+    return vk::SurfaceFormatKHR{ .format = vk::Format::eB8G8R8A8Unorm, .colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear };
+  }
+
+  for (const auto format : { vk::Format::eB8G8R8A8Unorm, vk::Format::eR8G8B8A8Unorm, vk::Format::eA8B8G8R8UnormPack32 })
+  {
+    const auto it = std::find_if(available.begin(), available.end(), [format](const auto& f) {
+      return f.format == format && f.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear;
+    });
+    if (it != available.end())
+    {
+      return *it;
+    }
+  }
+  return std::nullopt;
+}
+
+// descriptor indexing: one partially bound texture array holds the planes of every content.
+// the descriptor indexing features are optional in vulkan 1.2, timeline semaphores and host query reset are not
+inline vk::PhysicalDeviceVulkan12Features requiredVulkan12Features()
+{
+  return vk::PhysicalDeviceVulkan12Features{
+    .shaderSampledImageArrayNonUniformIndexing = true,
+    .descriptorBindingSampledImageUpdateAfterBind = true,
+    .descriptorBindingUpdateUnusedWhilePending = true,
+    .descriptorBindingPartiallyBound = true,
+    .runtimeDescriptorArray = true,
+    .hostQueryReset = true,
+    .timelineSemaphore = true,
+  };
+}
+
+// every feature requiredVulkan12Features() turns on is supported
+inline bool supportsRequiredFeatures(const vk::PhysicalDevice& physicalDevice)
+{
+  const auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>();
+  const auto required = requiredVulkan12Features();
+  return (features.shaderSampledImageArrayNonUniformIndexing || !required.shaderSampledImageArrayNonUniformIndexing)
+    && (features.descriptorBindingSampledImageUpdateAfterBind || !required.descriptorBindingSampledImageUpdateAfterBind)
+    && (features.descriptorBindingUpdateUnusedWhilePending || !required.descriptorBindingUpdateUnusedWhilePending)
+    && (features.descriptorBindingPartiallyBound || !required.descriptorBindingPartiallyBound)
+    && (features.runtimeDescriptorArray || !required.runtimeDescriptorArray)
+    && (features.hostQueryReset || !required.hostQueryReset)
+    && (features.timelineSemaphore || !required.timelineSemaphore);
+}
+
+struct QueueSelection
+{
+  uint32_t graphicsFamily = 0;
+  uint32_t transferFamily = 0;
+  uint32_t transferIndex = 0; // 1 when uploads use a second queue of the graphics family
+};
+
+// graphics: a family that can present, preferring one with timestamps and a second queue for uploads.
+// uploads: a transfer-only family (the dma engine) if there is one, else a compute family without graphics,
+// else a second queue of the graphics family, else the graphics queue itself
+inline std::optional<QueueSelection> selectQueues(const vk::PhysicalDevice& physicalDevice, vk::SurfaceKHR surface)
+{
+  const auto props = physicalDevice.getQueueFamilyProperties();
+
+  std::optional<uint32_t> graphics;
+  int bestScore = -1;
+  for (uint32_t i = 0; i < props.size(); i++)
+  {
+    const auto& prop = props[i];
+    if (!(prop.queueFlags & vk::QueueFlagBits::eGraphics) || (surface && !physicalDevice.getSurfaceSupportKHR(i, surface)))
+    {
+      continue;
+    }
+    const auto score = (prop.timestampValidBits > 0 ? 2 : 0) + (prop.queueCount > 1 ? 1 : 0);
+    if (score > bestScore)
+    {
+      graphics = i;
+      bestScore = score;
+    }
+  }
+  if (!graphics)
+  {
+    return std::nullopt;
+  }
+
+  auto selection = QueueSelection{
+    .graphicsFamily = *graphics,
+    .transferFamily = *graphics,
+    .transferIndex = props[*graphics].queueCount > 1 ? 1u : 0u,
+  };
+  bestScore = 0;
+  for (uint32_t i = 0; i < props.size(); i++)
+  {
+    const auto flags = props[i].queueFlags;
+    if (!(flags & vk::QueueFlagBits::eTransfer) || (flags & vk::QueueFlagBits::eGraphics))
+    {
+      continue;
+    }
+    const auto score = (flags & vk::QueueFlagBits::eCompute) ? 1 : 2;
+    if (score > bestScore)
+    {
+      selection.transferFamily = i;
+      selection.transferIndex = 0;
+      bestScore = score;
+    }
+  }
+  return selection;
+}
+
+// nullopt when the device cannot run the pipeline: no vulkan 1.2, a missing feature or extension or no queue that can present
+inline std::optional<uint32_t> scorePhysicalDevice(
+  const vk::PhysicalDevice& physicalDevice,
+  vk::SurfaceKHR surface,
+  const std::vector<const char*>& deviceExtensions,
+  PresentPolicy presentPolicy)
+{
+  const auto properties = physicalDevice.getProperties();
+  if (properties.apiVersion < VK_API_VERSION_1_2 || !supportsRequiredFeatures(physicalDevice))
+  {
+    return std::nullopt;
+  }
+
+  const auto available = physicalDevice.enumerateDeviceExtensionProperties();
+  for (const auto* extension : deviceExtensions)
+  {
+    if (available.end() == std::find_if(available.begin(), available.end(), [extension](const auto& a) { return std::strcmp(a.extensionName, extension) == 0; }))
+    {
+      return std::nullopt;
+    }
+  }
+
+  const auto queues = selectQueues(physicalDevice, surface);
+  if (!queues)
+  {
+    return std::nullopt;
+  }
+
+  uint32_t score = 0;
+  switch (properties.deviceType)
+  {
+    case vk::PhysicalDeviceType::eDiscreteGpu:
+      score += 1000;
+      break;
+    case vk::PhysicalDeviceType::eIntegratedGpu:
+      score += 500;
+      break;
+    case vk::PhysicalDeviceType::eVirtualGpu:
+      score += 100;
+      break;
+    default:
+      break;
+  }
+
+  // uploads overlap rendering on a dedicated queue
+  if (queues->transferFamily != queues->graphicsFamily || queues->transferIndex != 0)
+  {
+    score += 50;
+  }
+
+  if (surface)
+  {
+    if (!chooseSurfaceFormat(physicalDevice.getSurfaceFormatsKHR(surface)))
+    {
+      return std::nullopt;
+    }
+    if (presentPolicy != PresentPolicy::eTearFree
+        && choosePresentMode(physicalDevice.getSurfacePresentModesKHR(surface), presentPolicy) != vk::PresentModeKHR::eFifo)
+    {
+      score += 20;
+    }
+  }
+
+  return score;
+}
+
+// the usable device with the highest score. ties keep the enumeration order
+inline std::optional<vk::PhysicalDevice> selectPhysicalDevice(
+  const std::vector<vk::PhysicalDevice>& physicalDevices,
+  vk::SurfaceKHR surface,
+  const std::vector<const char*>& deviceExtensions,
+  PresentPolicy presentPolicy)
+{
+  std::optional<vk::PhysicalDevice> best;
+  uint32_t bestScore = 0;
+  for (const auto& physicalDevice : physicalDevices)
+  {
+    const auto score = scorePhysicalDevice(physicalDevice, surface, deviceExtensions, presentPolicy);
+    if (score && (!best || *score > bestScore))
+    {
+      best = physicalDevice;
+      bestScore = *score;
+    }
+  }
+  return best;
+}
+
+}}} // namespace daia::player::pipeline
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../../util/hash.hpp"
+#include "../common/pixel_format.hpp"
+
+namespace daia { namespace player { namespace pipeline {
+
+// Tile grid over the frame of one content, used to upload only the parts that changed.
+// A tile is tileSize pixels of the first plane and the matching smaller area of subsampled planes.
+// Tile edges fall on multiples of 4 bytes in every plane, so each region can be copied from its own buffer offset.
+class DirtyTiles
+{
+public:
+  static constexpr uint32_t tileSize = 64;
+
+  void reset(const common::PlaneLayout& layout)
+  {
+    _layout = layout;
+    _columns = (layout.planes[0].width + tileSize - 1) / tileSize;
+    _rows = (layout.planes[0].height + tileSize - 1) / tileSize;
+    _dirty.assign(_columns * _rows, false);
+    _hashes.assign(_columns * _rows, 0);
+    _hashed = false;
+  }
+
+  void markAll()
+  {
+    std::fill(_dirty.begin(), _dirty.end(), true);
+  }
+
+  // marks the tiles touched by region
+  void mark(const common::Region& region)
+  {
+    const auto column0 = std::min(region.x / tileSize, _columns);
+    const auto row0 = std::min(region.y / tileSize, _rows);
+    const auto column1 = std::min((region.x + region.width + tileSize - 1) / tileSize, _columns);
+    const auto row1 = std::min((region.y + region.height + tileSize - 1) / tileSize, _rows);
+    for (auto row = row0; row < row1; row++)
+    {
+      std::fill(_dirty.begin() + row * _columns + column0, _dirty.begin() + row * _columns + column1, true);
+    }
+  }
+
+  // unmarks tiles whose pixels are the same as the last time they were hashed.
+  // frame is laid out as the layout given to reset()
+  void dropUnchanged(const uint8_t* frame)
+  {
+    for (uint32_t row = 0; row < _rows; row++)
+    {
+      for (uint32_t column = 0; column < _columns; column++)
+      {
+        const auto tile = row * _columns + column;
+        if (!_dirty[tile])
+        {
+          continue;
+        }
+        const auto hash = _hash(frame, column, row);
+        if (_hashed && hash == _hashes[tile])
+        {
+          _dirty[tile] = false;
+        }
+        _hashes[tile] = hash;
+      }
+    }
+    _hashed = true;
+  }
+
+  // calls upload(region) for the marked tiles merged into rectangles and clears the marks.
+  // runs of tiles in a row become one region, full rows stacked on each other become one region
+  template <typename Upload>
+  void flush(Upload&& upload)
+  {
+    const auto width = _layout.planes[0].width;
+    const auto height = _layout.planes[0].height;
+
+    std::optional<common::Region> fullRows;
+    for (uint32_t row = 0; row < _rows; row++)
+    {
+      const auto y = row * tileSize;
+      const auto rowHeight = std::min(height, y + tileSize) - y;
+      for (uint32_t column = 0; column < _columns;)
+      {
+        if (!_dirty[row * _columns + column])
+        {
+          column++;
+          continue;
+        }
+
+        const auto first = column;
+        while (column < _columns && _dirty[row * _columns + column])
+        {
+          _dirty[row * _columns + column] = false;
+          column++;
+        }
+
+        const auto x = first * tileSize;
+        const auto region = common::Region{ .x = x, .y = y, .width = std::min(width, column * tileSize) - x, .height = rowHeight };
+        if (first != 0 || column != _columns)
+        {
+          upload(region);
+        }
+        else if (fullRows && fullRows->y + fullRows->height == y)
+        {
+          fullRows->height += rowHeight;
+        }
+        else
+        {
+          if (fullRows)
+          {
+            upload(*fullRows);
+          }
+          fullRows = region;
+        }
+      }
+    }
+
+    if (fullRows)
+    {
+      upload(*fullRows);
+    }
+  }
+
+  // the part of plane covered by region, a rectangle of the first plane
+  static common::Region planeRegion(const common::Plane& plane, const common::Region& region)
+  {
+    const auto round = (1u << plane.subsampling) - 1;
+    const auto x = region.x >> plane.subsampling;
+    const auto y = region.y >> plane.subsampling;
+    return {
+      .x = x,
+      .y = y,
+      .width = std::min(plane.width, (region.x + region.width + round) >> plane.subsampling) - x,
+      .height = std::min(plane.height, (region.y + region.height + round) >> plane.subsampling) - y,
+    };
+  }
+
+private:
+  uint64_t _hash(const uint8_t* frame, uint32_t column, uint32_t row) const
+  {
+    const auto tile = common::Region{ .x = column * tileSize, .y = row * tileSize, .width = tileSize, .height = tileSize };
+
+    uint64_t hash = 0;
+    for (uint32_t i = 0; i < _layout.count; i++)
+    {
+      const auto& plane = _layout.planes[i];
+      const auto area = planeRegion(plane, tile);
+      const auto* data = frame + plane.offset + area.y * plane.rowPitch() + area.x * plane.bytesPerPixel;
+      for (uint32_t y = 0; y < area.height; y++)
+      {
+        hash = util::hashBytes(data + y * plane.rowPitch(), area.width * plane.bytesPerPixel, hash);
+      }
+    }
+    return hash;
+  }
+
+  common::PlaneLayout _layout;
+  uint32_t _columns = 0;
+  uint32_t _rows = 0;
+  std::vector<bool> _dirty;
+  std::vector<uint64_t> _hashes;
+  bool _hashed = false;
+};
+
+}}} // namespace daia::player::pipeline
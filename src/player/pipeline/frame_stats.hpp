@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace daia { namespace player { namespace pipeline {
+
+// Where the time of one frame went, in milliseconds.
+// cpu times are measured on the thread calling Pipeline::update/draw, gpu times come from timestamp queries.
+struct FrameStats
+{
+  uint64_t frame = 0;
+
+  // cpu
+  double fenceWait = 0;     // waiting for the frame slot to be free
+  double contentUpdate = 0; // Content::update of every content
+  double stagingWrite = 0;  // Content::write into staging memory and tile hashing
+  double uploadRecord = 0;  // recording and submitting the upload copies
+  double acquire = 0;
+  double drawRecord = 0; // recording and submitting the render pass
+  double present = 0;
+
+  // gpu. 0 when nothing was timed, e.g. no upload this frame or no timestamp support on the queue
+  double gpuUpload = 0;
+  double gpuRender = 0;
+
+  uint32_t uploadCopies = 0;
+  uint64_t uploadBytes = 0;
+
+  double cpuTotal() const
+  {
+    return fenceWait + contentUpdate + stagingWrite + uploadRecord + acquire + drawRecord + present;
+  }
+
+  FrameStats& operator+=(const FrameStats& rhs)
+  {
+    frame = rhs.frame;
+    fenceWait += rhs.fenceWait;
+    contentUpdate += rhs.contentUpdate;
+    stagingWrite += rhs.stagingWrite;
+    uploadRecord += rhs.uploadRecord;
+    acquire += rhs.acquire;
+    drawRecord += rhs.drawRecord;
+    present += rhs.present;
+    gpuUpload += rhs.gpuUpload;
+    gpuRender += rhs.gpuRender;
+    uploadCopies += rhs.uploadCopies;
+    uploadBytes += rhs.uploadBytes;
+    return *this;
+  }
+};
+
+// adds the time between construction and destruction to a FrameStats field
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(double& ms)
+    : _ms(ms)
+    , _start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedTimer()
+  {
+    _ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  double& _ms;
+  std::chrono::steady_clock::time_point _start;
+};
+
+}}} // namespace daia::player::pipeline
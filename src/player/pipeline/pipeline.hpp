@@ -1,871 +1,1876 @@
-#pragma once
-
-#include <algorithm>
-#include <cassert>
-#include <cstdint>
-#include <cstring>
-#include <iostream>
-#include <memory>
-#include <string>
-#include <unordered_map>
-#include <vector>
-
-#define VULKAN_HPP_NO_CONSTRUCTORS
-#include <vulkan/vulkan.hpp>
-
-#include "../../util/util.hpp"
-#include "../common/texture.hpp"
-#include "../content/content_base.hpp"
-#include "../window.hpp"
-#include "helpers.hpp"
-#include "viewport.hpp"
-
-namespace daia { namespace player { namespace pipeline {
-
-struct SetupArgs
-{
-  const std::filesystem::path appRoot;
-  const std::string appName;
-  uint32_t width;
-  uint32_t height;
-  std::vector<const char*> instanceExtensions;
-  std::vector<const char*> deviceExtensions;
-  std::vector<const char*> layers;
-  const bool enableValidationLayers = false;
-  const Window& window;
-
-  void normalize()
-  {
-    deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-
-    if (enableValidationLayers)
-    {
-      layers.push_back("VK_LAYER_KHRONOS_validation");
-      instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-    }
-
-    util::distinct(instanceExtensions);
-    util::distinct(deviceExtensions);
-    util::distinct(layers);
-  }
-};
-
-class Pipeline
-{
-private:
-  struct WrappedContent
-  {
-    std::shared_ptr<content::Content> content = nullptr;
-    common::Texture texture;
-  };
-
-  static std::vector<const char*> checkDeviceExtensions(const vk::PhysicalDevice& device, const std::vector<const char*>& requestedExtensions)
-  {
-    const auto& extensions = device.enumerateDeviceExtensionProperties();
-    std::vector<const char*> missing;
-    for (const auto& r : requestedExtensions)
-    {
-      if (extensions.end() == std::find_if(extensions.begin(), extensions.end(), [&r](const auto& a) { return std::strcmp(a.extensionName, r) == 0; }))
-      {
-        missing.push_back(r);
-      }
-    }
-    return missing;
-  }
-
-public:
-  Pipeline() = default;
-  ~Pipeline() { destroy(); }
-
-  Pipeline(const Pipeline&) = delete;
-  Pipeline& operator=(const Pipeline&) = delete;
-  Pipeline(Pipeline&&) = default;
-  Pipeline& operator=(Pipeline&&) = default;
-
-  bool setup(SetupArgs& info)
-  {
-    info.normalize();
-
-    auto missingLayers = checkLayers(info.layers);
-    if (missingLayers.size() > 0)
-    {
-      util::println("Layers not found");
-      for (const auto& l : missingLayers)
-      {
-        util::println(l);
-      }
-      return false;
-    }
-
-    // instance
-    vk::ApplicationInfo appInfo{
-      .pApplicationName = info.appName.c_str(),
-      .apiVersion = VK_API_VERSION_1_3,
-    };
-
-    _instance = vk::createInstanceUnique({
-      .pApplicationInfo = &appInfo,
-      .enabledLayerCount = static_cast<uint32_t>(info.layers.size()),
-      .ppEnabledLayerNames = info.layers.data(),
-      .enabledExtensionCount = static_cast<uint32_t>(info.instanceExtensions.size()),
-      .ppEnabledExtensionNames = info.instanceExtensions.data(),
-    });
-
-    // debug messenger
-    {
-      VkDebugUtilsMessengerCreateInfoEXT info = {};
-      info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-      info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-      info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-      info.pfnUserCallback = debugCallback;
-
-      if (CreateDebugUtilsMessengerEXT(*_instance, &info, nullptr, &_debugMessenger) != VK_SUCCESS)
-      {
-        std::cerr << "Failed to set up debug messenger!" << std::endl;
-        return false;
-      }
-    }
-
-    // surface
-    _surface = info.window.createSurface(*_instance);
-
-    // physical device
-    {
-      // todo: query by
-      //   - device extensions
-      //   - surface format
-      //   - surface presentModes
-      _physicalDevice = _instance->enumeratePhysicalDevices().front();
-      const auto props = _physicalDevice.getQueueFamilyProperties();
-      _queueFamilyIndex = props.size();
-      for (int i = 0; i < props.size(); i++)
-      {
-        const auto& prop = props[i];
-        if (prop.queueFlags & vk::QueueFlagBits::eGraphics && _physicalDevice.getSurfaceSupportKHR(i, _surface))
-        {
-          _queueFamilyIndex = i;
-          break;
-        }
-      }
-      if (_queueFamilyIndex == props.size())
-      {
-        std::cerr << "Failed to find queue family property" << std::endl;
-        return false;
-      }
-    }
-
-    // logical device
-    {
-      const float queuePriority = 1;
-      const auto deviceQueueCreateInfo = vk::DeviceQueueCreateInfo{
-        .queueFamilyIndex = _queueFamilyIndex,
-        .queueCount = 1,
-        .pQueuePriorities = &queuePriority,
-      };
-
-      vk::PhysicalDeviceFeatures deviceFeatures = {};
-
-      _device = _physicalDevice.createDeviceUnique({
-        .flags = vk::DeviceCreateFlags(),
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &deviceQueueCreateInfo,
-        .enabledLayerCount = static_cast<uint32_t>(info.layers.size()),
-        .ppEnabledLayerNames = info.layers.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(info.deviceExtensions.size()),
-        .ppEnabledExtensionNames = info.deviceExtensions.data(),
-        .pEnabledFeatures = &deviceFeatures,
-      });
-
-      _graphicsQueue = _device->getQueue(_queueFamilyIndex, 0);
-    }
-
-    // command buffer
-    _commandPool = _device->createCommandPoolUnique({
-      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-      .queueFamilyIndex = _queueFamilyIndex,
-    });
-    _commandBuffers = _device->allocateCommandBuffers({
-      .commandPool = *_commandPool,
-      .level = vk::CommandBufferLevel::ePrimary,
-      .commandBufferCount = 1,
-    });
-
-    // swapchain
-    {
-      const auto formats = _physicalDevice.getSurfaceFormatsKHR(_surface);
-      // check capabilities
-      _colorFormat = vk::Format::eB8G8R8A8Unorm;
-      const auto colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
-      const auto presentMode = vk::PresentModeKHR::eFifo;
-
-      const auto capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface);
-      _swapchainExtent = capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()
-        ? capabilities.currentExtent
-        : vk::Extent2D{
-            .width = std::clamp(info.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
-            .height = std::clamp(info.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height),
-          };
-
-      auto imageCount = capabilities.minImageCount + 1;
-      if (capabilities.maxImageCount > 0 && capabilities.maxImageCount < imageCount)
-      {
-        imageCount = capabilities.maxImageCount;
-      }
-
-      _swapchain = _device->createSwapchainKHRUnique({
-        .surface = _surface,
-        .minImageCount = imageCount,
-        .imageFormat = _colorFormat,
-        .imageColorSpace = colorSpace,
-        .imageExtent = _swapchainExtent,
-        .imageArrayLayers = 1,
-        .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
-        .imageSharingMode = vk::SharingMode::eExclusive,
-        .preTransform = capabilities.currentTransform,
-        .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-        .presentMode = presentMode,
-        .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
-      });
-
-      _swapchainImages = _device->getSwapchainImagesKHR(*_swapchain);
-      for (const auto& image : _swapchainImages)
-      {
-        _swapchainImageViews.emplace_back(_device->createImageViewUnique({
-          .image = image,
-          .viewType = vk::ImageViewType::e2D,
-          .format = _colorFormat,
-          .components = {
-            .r = vk::ComponentSwizzle::eIdentity,
-            .g = vk::ComponentSwizzle::eIdentity,
-            .b = vk::ComponentSwizzle::eIdentity,
-            .a = vk::ComponentSwizzle::eIdentity,
-          },
-          .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-          },
-        }));
-      }
-    }
-
-    // semaphores
-    _imageAcquiredSemaphore = _device->createSemaphoreUnique({});
-    _renderFinishedSemaphore = _device->createSemaphoreUnique({});
-
-    // fence
-    _drawFence = _device->createFenceUnique({
-      .flags = vk::FenceCreateFlagBits::eSignaled,
-    });
-
-    // render pass
-    {
-      std::array<vk::AttachmentDescription, 1> attachmentDescriptions{
-        // color
-        vk::AttachmentDescription{
-          .format = _colorFormat,
-          .samples = vk::SampleCountFlagBits::e1,
-          .loadOp = vk::AttachmentLoadOp::eDontCare,
-          .storeOp = vk::AttachmentStoreOp::eStore,
-          .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
-          .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-          .initialLayout = vk::ImageLayout::eUndefined,
-          .finalLayout = vk::ImageLayout::ePresentSrcKHR,
-        },
-      };
-
-      const auto colorReference = vk::AttachmentReference{
-        .attachment = 0,
-        .layout = vk::ImageLayout::eColorAttachmentOptimal,
-      };
-
-      const auto subpass = vk::SubpassDescription{
-        .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &colorReference,
-      };
-
-      _renderPass = _device->createRenderPassUnique({
-        .attachmentCount = attachmentDescriptions.size(),
-        .pAttachments = attachmentDescriptions.data(),
-        .subpassCount = 1,
-        .pSubpasses = &subpass,
-      });
-    }
-
-    // pipeline
-    {
-      _vertShaderModule = createShaderModule(*_device, info.appRoot / "../player/pipeline/shader/pane.vert.spv");
-      _fragShaderModule = createShaderModule(*_device, info.appRoot / "../player/pipeline/shader/pane.frag.spv");
-
-      std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfo = {
-        vk::PipelineShaderStageCreateInfo{
-          .stage = vk::ShaderStageFlagBits::eVertex,
-          .module = *_vertShaderModule,
-          .pName = "main",
-        },
-        vk::PipelineShaderStageCreateInfo{
-          .stage = vk::ShaderStageFlagBits::eFragment,
-          .module = *_fragShaderModule,
-          .pName = "main",
-        }
-      };
-
-      const auto vertexInputInfo = vk::PipelineVertexInputStateCreateInfo{
-        .vertexBindingDescriptionCount = 0,
-        .vertexAttributeDescriptionCount = 0,
-      };
-
-      const auto inputAssembly = vk::PipelineInputAssemblyStateCreateInfo{
-        .topology = vk::PrimitiveTopology::eTriangleList,
-        .primitiveRestartEnable = false,
-      };
-
-      const auto rasterizer = vk::PipelineRasterizationStateCreateInfo{
-        .depthClampEnable = false,
-        .rasterizerDiscardEnable = false,
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        .frontFace = vk::FrontFace::eClockwise,
-        .depthBiasEnable = false,
-        .lineWidth = 1.0,
-      };
-
-      const auto multisampling = vk::PipelineMultisampleStateCreateInfo{
-        .rasterizationSamples = vk::SampleCountFlagBits::e1,
-        .sampleShadingEnable = vk::False,
-      };
-
-      {
-        std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
-          vk::DescriptorSetLayoutBinding{
-            .binding = 0,
-            .descriptorType = vk::DescriptorType::eUniformBuffer,
-            .descriptorCount = 1,
-            .stageFlags = vk::ShaderStageFlagBits::eFragment,
-          },
-          vk::DescriptorSetLayoutBinding{
-            .binding = 1,
-            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-            .descriptorCount = 1,
-            .stageFlags = vk::ShaderStageFlagBits::eFragment,
-          }
-        };
-        _descriptorSetLayout = _device->createDescriptorSetLayoutUnique({
-          .bindingCount = static_cast<uint32_t>(bindings.size()),
-          .pBindings = bindings.data(),
-        });
-
-        const auto pushConstantRanges = vk::PushConstantRange{
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
-          .offset = 0,
-          .size = sizeof(PushConstant),
-        };
-
-        auto descriptorSetLayout = *_descriptorSetLayout;
-        _pipelineLayout = _device->createPipelineLayoutUnique({
-          .setLayoutCount = 1,
-          .pSetLayouts = &descriptorSetLayout,
-          .pushConstantRangeCount = 1,
-          .pPushConstantRanges = &pushConstantRanges,
-        });
-      }
-
-      const auto dynamicStates = std::vector<vk::DynamicState>{
-        vk::DynamicState::eViewport,
-        vk::DynamicState::eScissor,
-      };
-      const auto dynamicState = vk::PipelineDynamicStateCreateInfo{
-        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data(),
-      };
-
-      const auto colorBlendingAttachment = vk::PipelineColorBlendAttachmentState{
-        .blendEnable = false,
-        .srcColorBlendFactor = vk::BlendFactor::eOne,
-        .dstColorBlendFactor = vk::BlendFactor::eZero,
-        .colorBlendOp = vk::BlendOp::eAdd,
-        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
-        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
-        .alphaBlendOp = vk::BlendOp::eAdd,
-        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
-      };
-
-      const auto colorBlending = vk::PipelineColorBlendStateCreateInfo{
-        .logicOpEnable = false,
-        .logicOp = vk::LogicOp::eCopy,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendingAttachment,
-        .blendConstants = {},
-      };
-
-      const auto viewportState = vk::PipelineViewportStateCreateInfo{
-        .viewportCount = 1,
-        .scissorCount = 1,
-      };
-
-      auto [result, pipeline] = _device->createGraphicsPipelineUnique(
-        nullptr,
-        {
-          .stageCount = shaderStageCreateInfo.size(),
-          .pStages = shaderStageCreateInfo.data(),
-          .pVertexInputState = &vertexInputInfo,
-          .pInputAssemblyState = &inputAssembly,
-          .pViewportState = &viewportState,
-          .pRasterizationState = &rasterizer,
-          .pMultisampleState = &multisampling,
-          .pColorBlendState = &colorBlending,
-          .pDynamicState = &dynamicState,
-          .layout = *_pipelineLayout,
-          .renderPass = *_renderPass,
-          .subpass = 0,
-        });
-      switch (result)
-      {
-        case vk::Result::eSuccess:
-          break;
-        case vk::Result::ePipelineCompileRequiredEXT:
-          // something meaningfull here
-          break;
-        default:
-          assert(false); // should never happen
-      }
-      _pipeline = std::move(pipeline);
-    }
-
-    // framebuffers
-    _frameBuffers.resize(_swapchainImageViews.size());
-    std::transform(_swapchainImageViews.begin(), _swapchainImageViews.end(), _frameBuffers.begin(), [this](const auto& view) {
-      auto viewHandle = *view;
-      return _device->createFramebufferUnique({
-        .renderPass = *_renderPass,
-        .attachmentCount = 1,
-        .pAttachments = &viewHandle,
-        .width = _swapchainExtent.width,
-        .height = _swapchainExtent.height,
-        .layers = 1,
-      });
-    });
-
-    // ubo
-    {
-      _blankViewUboBuffer = _device->createBufferUnique({
-        .size = sizeof(ViewportSet::BlankUboData),
-        .usage = vk::BufferUsageFlagBits::eUniformBuffer,
-        .sharingMode = vk::SharingMode::eExclusive,
-      });
-
-      vk::MemoryRequirements memRequirements = _device->getBufferMemoryRequirements(*_blankViewUboBuffer);
-      _blankViewUboMemory = _device->allocateMemoryUnique(
-        { .allocationSize = memRequirements.size,
-          .memoryTypeIndex = common::findMemoryType(
-            _physicalDevice,
-            memRequirements.memoryTypeBits,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent) });
-
-      _device->bindBufferMemory(*_blankViewUboBuffer, *_blankViewUboMemory, 0);
-    }
-
-    // descriptor set
-    {
-      std::array<vk::DescriptorPoolSize, 2> poolSizes{
-        vk::DescriptorPoolSize{ .type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 1 },
-        vk::DescriptorPoolSize{ .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1 },
-      };
-
-      _descriptorPool = _device->createDescriptorPoolUnique({
-        .maxSets = 2,
-        .poolSizeCount = 2,
-        .pPoolSizes = poolSizes.data(),
-      });
-
-      auto descriptorSetLayout = *_descriptorSetLayout;
-      _descriptorSets = _device->allocateDescriptorSets({
-        .descriptorPool = *_descriptorPool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &descriptorSetLayout,
-      });
-    }
-
-    createViewports();
-
-    return true;
-  }
-
-  void createViewports()
-  {
-    _viewports.add({ 0.1, 0.1, 0.3, 0.6, util::float4{ 0.4, 0.6, 0.2, 1.0 } });
-    _viewports.add({ 0.5, 0, 0.5, 1, util::float4{ 0.2, 0.6, 0.8, 1.0 } });
-
-    const auto uboData = _viewports.getBlankUboData();
-    constexpr auto size = sizeof(ViewportSet::BlankUboData);
-    void* data = _device->mapMemory(*_blankViewUboMemory, 0, size);
-    memcpy(data, &uboData, size);
-    _device->unmapMemory(*_blankViewUboMemory);
-
-    const auto bufferInfo = vk::DescriptorBufferInfo{
-      .buffer = *_blankViewUboBuffer,
-      .offset = 0,
-      .range = sizeof(ViewportSet::BlankUboData),
-    };
-    const auto write = vk::WriteDescriptorSet{
-      .dstSet = _descriptorSets.front(),
-      .dstBinding = 0,
-      .descriptorCount = 1,
-      .descriptorType = vk::DescriptorType::eUniformBuffer,
-      .pBufferInfo = &bufferInfo,
-    };
-    _device->updateDescriptorSets(1, &write, 0, nullptr);
-  }
-
-  void recordCommand(const vk::CommandBuffer& commandBuffer, const uint32_t currentIndex)
-  {
-    commandBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlags() });
-
-    commandBuffer.beginRenderPass(
-      {
-        .renderPass = *_renderPass,
-        .framebuffer = *_frameBuffers[currentIndex],
-        .renderArea = {
-          .offset = { 0, 0 },
-          .extent = _swapchainExtent,
-        },
-      },
-      vk::SubpassContents::eInline);
-
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *_pipeline);
-    commandBuffer.bindDescriptorSets(
-      vk::PipelineBindPoint::eGraphics,
-      *_pipelineLayout,
-      0,
-      1,
-      _descriptorSets.data(),
-      0,
-      nullptr);
-
-    for (uint32_t i = 0; i < _viewports.size(); i++)
-    {
-      const auto pushConstant = PushConstant{
-        .viewportIndex = i
-      };
-      const auto& vp = _viewports.get(i, _swapchainExtent);
-      commandBuffer.setViewport(0, vp.viewport);
-      commandBuffer.setScissor(0, vp.scissor);
-      commandBuffer.pushConstants(*_pipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(PushConstant), &pushConstant);
-      commandBuffer.draw(9, 1, 0, 0);
-    }
-
-    commandBuffer.endRenderPass();
-
-    commandBuffer.end();
-  }
-
-  void draw()
-  {
-    const auto& commandBuffer = _commandBuffers.front();
-
-    const auto swapchain = *_swapchain;
-    const auto imageAcquiredSemaphore = *_imageAcquiredSemaphore;
-    const auto renderFinishedSemaphore = *_renderFinishedSemaphore;
-
-    const auto currentIndex = _device->acquireNextImageKHR(swapchain, std::numeric_limits<uint64_t>::max(), imageAcquiredSemaphore, nullptr).value;
-    _device->resetFences(*_drawFence);
-
-    recordCommand(commandBuffer, currentIndex);
-
-    const auto waitDestinationStageMask = vk::PipelineStageFlags{
-      vk::PipelineStageFlagBits::eColorAttachmentOutput,
-    };
-    _graphicsQueue.submit(
-      { {
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &imageAcquiredSemaphore,
-        .pWaitDstStageMask = &waitDestinationStageMask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &commandBuffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &renderFinishedSemaphore,
-      } },
-      *_drawFence);
-
-    while (vk::Result::eTimeout == _device->waitForFences({ *_drawFence }, true, std::numeric_limits<uint64_t>::max()))
-      ;
-
-    const auto result = _graphicsQueue.presentKHR({
-      .waitSemaphoreCount = 1,
-      .pWaitSemaphores = &renderFinishedSemaphore,
-      .swapchainCount = 1,
-      .pSwapchains = &swapchain,
-      .pImageIndices = &currentIndex,
-    });
-    switch (result)
-    {
-      case vk::Result::eSuccess:
-        break;
-      case vk::Result::eSuboptimalKHR:
-        std::cout << "vk::Queue::presentKHR returned vk::Result::eSuboptimalKHR !\n";
-        break;
-      default:
-        assert(false); // an unexpected result is returned !
-    }
-  }
-
-  void update(double globalTime)
-  {
-    _device->resetFences(*_drawFence);
-
-    auto& commandBuffer = _commandBuffers.front();
-
-    commandBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlags() });
-
-    std::vector<vk::UniqueBuffer> buffers;
-    std::vector<vk::UniqueDeviceMemory> memories; // 一つに
-
-    for (const auto& [_, t] : _contents)
-    {
-      const auto& viewport = _viewports.get(0, _swapchainExtent);
-      const auto& [content, texture] = t;
-
-      if (content->update({
-            .time = globalTime,
-            .width = viewport.viewport.width,
-            .height = viewport.viewport.height,
-          }))
-      {
-        // cpu texture upload
-
-        const auto size = texture.calcBufferSize();
-
-        const auto& stagingBuffer = buffers.emplace_back(_device->createBufferUnique({
-          .size = size,
-          .usage = vk::BufferUsageFlagBits::eTransferSrc,
-          .sharingMode = vk::SharingMode::eExclusive,
-        }));
-
-        const auto memReqs = _device->getBufferMemoryRequirements(*stagingBuffer);
-        const auto& stagingMemory = memories.emplace_back(_device->allocateMemoryUnique(
-          {
-            .allocationSize = memReqs.size,
-            .memoryTypeIndex = common::findMemoryType(
-              _physicalDevice,
-              memReqs.memoryTypeBits,
-              vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent),
-          }));
-
-        _device->bindBufferMemory(*stagingBuffer, *stagingMemory, 0);
-        void* mapped = _device->mapMemory(*stagingMemory, 0, size);
-        memcpy(mapped, content->data().data(), size);
-        _device->unmapMemory(*stagingMemory);
-
-        commandBuffer.pipelineBarrier(
-          vk::PipelineStageFlagBits::eTopOfPipe,
-          vk::PipelineStageFlagBits::eTransfer,
-          {},
-          nullptr,
-          nullptr,
-          vk::ImageMemoryBarrier{
-            .srcAccessMask = {},
-            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
-            .oldLayout = vk::ImageLayout::eUndefined,
-            .newLayout = vk::ImageLayout::eTransferDstOptimal,
-            .image = *texture.image,
-            .subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 } });
-
-        auto [w, h] = content->size();
-        commandBuffer.copyBufferToImage(
-          *stagingBuffer,
-          *texture.image,
-          vk::ImageLayout::eTransferDstOptimal,
-          vk::BufferImageCopy{
-            .bufferOffset = 0,
-            .bufferRowLength = 0,
-            .bufferImageHeight = 0,
-            .imageSubresource = {
-              .aspectMask = vk::ImageAspectFlagBits::eColor,
-              .mipLevel = 0,
-              .baseArrayLayer = 0,
-              .layerCount = 1,
-            },
-            .imageOffset = { 0, 0, 0 },
-            .imageExtent = { w, h, 1 },
-          });
-
-        commandBuffer.pipelineBarrier(
-          vk::PipelineStageFlagBits::eTransfer,
-          vk::PipelineStageFlagBits::eFragmentShader,
-          {},
-          nullptr,
-          nullptr,
-          vk::ImageMemoryBarrier{
-            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
-            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
-            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-            .image = *texture.image,
-            .subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 } });
-      }
-    }
-
-    commandBuffer.end();
-
-    _graphicsQueue.submit(
-      { {
-        .waitSemaphoreCount = 0,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &commandBuffer,
-        .signalSemaphoreCount = 0,
-      } },
-      *_drawFence);
-
-    while (vk::Result::eTimeout == _device->waitForFences({ *_drawFence }, true, std::numeric_limits<uint64_t>::max()))
-      ;
-
-    _graphicsQueue.waitIdle();
-    commandBuffer.reset();
-  }
-
-  bool registerContent(const std::string& key, std::shared_ptr<content::Content> content)
-  {
-    if (_contents.contains(key))
-    {
-      return false;
-    }
-
-    util::println("register content: {}", key);
-
-    content->setup({
-      .device = _device,
-      .physicalDevice = _physicalDevice,
-    });
-
-    // setup texture
-    auto [w, h] = content->size();
-    auto texture = common::Texture();
-    texture.setup(_device, _physicalDevice, w, h);
-
-    const auto imageInfo = texture.createDescriptorInfo();
-    const auto write = vk::WriteDescriptorSet{
-      .dstSet = _descriptorSets.front(),
-      .dstBinding = 1,
-      .descriptorCount = 1,
-      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-      .pImageInfo = &imageInfo,
-    };
-    _device->updateDescriptorSets(1, &write, 0, nullptr);
-
-    _contents[std::move(key)] = {
-      .content = std::move(content),
-      .texture = std::move(texture),
-    };
-
-    return true;
-  }
-
-  void unregisterContent(std::string key)
-  {
-    if (auto it = _contents.find(key); it != _contents.end())
-    {
-      util::println("unregister content: {}", key);
-      it->second.content->destroy();
-      it->second.texture.destroy();
-      _contents.erase(it);
-    }
-  }
-
-  void unregisterAllContents()
-  {
-    util::println("clear contents: ({})", _contents.size());
-    for (auto& [_, t] : _contents)
-    {
-      t.content->destroy();
-      t.texture.destroy();
-    }
-    _contents.clear();
-  }
-
-  void destroy()
-  {
-    if (!_instance)
-      return;
-
-    if (_device)
-      _device->waitIdle();
-
-    // Reset device-owned resources
-    unregisterAllContents();
-    _blankViewUboMemory.reset();
-    _blankViewUboBuffer.reset();
-    _frameBuffers.clear();
-    _pipeline.reset();
-    _pipelineLayout.reset();
-    _renderPass.reset();
-    _vertShaderModule.reset();
-    _fragShaderModule.reset();
-    _imageAcquiredSemaphore.reset();
-    _renderFinishedSemaphore.reset();
-    _drawFence.reset();
-    _swapchainImageViews.clear();
-    _swapchain.reset();
-    _descriptorPool.reset();
-    _descriptorSetLayout.reset();
-    _commandBuffers.clear();
-    _commandPool.reset();
-    _device.reset();
-
-    // Manually managed instance-owned resources
-    _instance->destroySurfaceKHR(_surface);
-    _surface = nullptr;
-    DestroyDebugUtilsMessengerEXT(*_instance, _debugMessenger, nullptr);
-    _debugMessenger = {};
-    _instance.reset();
-  }
-
-private:
-  vk::UniqueInstance _instance;
-  VkDebugUtilsMessengerEXT _debugMessenger = {};
-  vk::SurfaceKHR _surface;
-  vk::PhysicalDevice _physicalDevice;
-
-  vk::UniqueDevice _device;
-
-  uint32_t _queueFamilyIndex = 0;
-  vk::Queue _graphicsQueue;
-
-  vk::UniqueCommandPool _commandPool;
-  std::vector<vk::CommandBuffer> _commandBuffers;
-
-  vk::UniqueSwapchainKHR _swapchain;
-  vk::Format _colorFormat = {};
-  vk::Extent2D _swapchainExtent = {};
-  std::vector<vk::Image> _swapchainImages;
-  std::vector<vk::UniqueImageView> _swapchainImageViews;
-  std::vector<vk::UniqueFramebuffer> _frameBuffers;
-
-  ViewportSet _viewports;
-
-  vk::UniqueSemaphore _imageAcquiredSemaphore;
-  vk::UniqueSemaphore _renderFinishedSemaphore;
-  vk::UniqueFence _drawFence;
-
-  vk::UniqueDescriptorSetLayout _descriptorSetLayout;
-  vk::UniqueDescriptorPool _descriptorPool;
-  std::vector<vk::DescriptorSet> _descriptorSets;
-
-  vk::UniquePipelineLayout _pipelineLayout;
-  vk::UniquePipeline _pipeline;
-
-  vk::UniqueRenderPass _renderPass;
-
-  vk::UniqueShaderModule _vertShaderModule;
-  vk::UniqueShaderModule _fragShaderModule;
-
-  vk::UniqueBuffer _blankViewUboBuffer;
-  vk::UniqueDeviceMemory _blankViewUboMemory;
-
-  std::unordered_map<std::string, WrappedContent> _contents;
-};
-
-}}} // namespace daia::player::pipeline
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "../../util/image.hpp"
+#include "../../util/thread_budget.hpp"
+#include "../../util/trace.hpp"
+#include "../../util/util.hpp"
+#include "../common/pixel_format.hpp"
+#include "../common/texture.hpp"
+#include "../content/content_base.hpp"
+#include "../media/decode_scheduler.hpp"
+#include "../window.hpp"
+#include "device_selection.hpp"
+#include "dirty_tiles.hpp"
+#include "frame_stats.hpp"
+#include "helpers.hpp"
+#include "pipeline_cache.hpp"
+#include "shader/shaders.hpp"
+#include "staging.hpp"
+#include "viewport.hpp"
+
+namespace daia { namespace player { namespace pipeline {
+
+struct SetupArgs
+{
+  const std::filesystem::path appRoot;
+  const std::string appName;
+  uint32_t width;
+  uint32_t height;
+  std::vector<const char*> instanceExtensions;
+  std::vector<const char*> deviceExtensions;
+  std::vector<const char*> layers;
+  const bool enableValidationLayers = false;
+  const Window* window = nullptr; // nullptr renders into offscreen images instead of a swapchain
+  uint32_t framesInFlight = 2;
+  bool hashTiles = false; // skip uploading tiles whose pixels did not change. costs a read of every frame on the cpu
+  bool waitForFrames = false; // contents block until the frame due at each update is decoded. for reproducible frame dumps
+  bool mipmaps = false;   // content textures get a full mip chain, rebuilt on the gpu after each upload. for panes smaller than their content
+  bool releaseHiddenContents = false; // contents no pane shows free their decode buffers while hidden
+  uint32_t decodeThreadBudget = 0;     // decoding threads shared by all shown contents, the decode scheduler's workers included. 0 uses one per core
+  PresentPolicy presentPolicy = PresentPolicy::eTearFree;
+  std::filesystem::path pipelineCachePath; // empty disables the persistent pipeline cache
+
+  void normalize()
+  {
+    if (window)
+    {
+      deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    if (enableValidationLayers)
+    {
+      layers.push_back("VK_LAYER_KHRONOS_validation");
+      instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    util::distinct(instanceExtensions);
+    util::distinct(deviceExtensions);
+    util::distinct(layers);
+  }
+};
+
+class Pipeline
+{
+private:
+  struct UploadCopy
+  {
+    vk::Image image;
+    vk::BufferImageCopy region;
+  };
+
+  // resources of one frame in flight. uploads are recorded on the transfer queue, the render pass on the graphics queue
+  struct Frame
+  {
+    vk::CommandBuffer commandBuffer;
+    vk::CommandBuffer transferCommandBuffer;
+    vk::UniqueFence fence;
+    vk::UniqueSemaphore imageAcquired;
+    vk::DeviceSize stagingMark = 0;
+    FrameStats stats;
+    bool uploadTimed = false;
+    bool renderTimed = false;
+  };
+
+  struct WrappedContent
+  {
+    std::shared_ptr<content::Content> content = nullptr;
+    common::PlaneLayout layout;
+    common::PixelFormat format = common::PixelFormat::eRGBA8;
+    common::ColorSpace colorSpace;
+    uint32_t slot = 0;                   // planes are bound at textures[slot * maxPlaneCount + plane]
+    std::vector<common::Texture> planes; // one texture per plane of layout
+    DirtyTiles tiles;
+    bool uploaded = false; // planes hold a frame, so partial uploads keep the rest of it
+    bool suspended = false; // no pane shows it. not updated until one does
+    bool resized = false;   // the current frame does not fit the textures. they are recreated before the next update
+    bool stale = false;     // the current frame is not uploaded yet, the staging buffer was full. retried each update
+  };
+
+  static std::vector<const char*> checkDeviceExtensions(const vk::PhysicalDevice& device, const std::vector<const char*>& requestedExtensions)
+  {
+    const auto& extensions = device.enumerateDeviceExtensionProperties();
+    std::vector<const char*> missing;
+    for (const auto& r : requestedExtensions)
+    {
+      if (extensions.end() == std::find_if(extensions.begin(), extensions.end(), [&r](const auto& a) { return std::strcmp(a.extensionName, r) == 0; }))
+      {
+        missing.push_back(r);
+      }
+    }
+    return missing;
+  }
+
+public:
+  // upper bound of registered contents; the device limits may lower it
+  static constexpr uint32_t maxContentCount = 256;
+
+  // color of a pane whose content is still opening
+  static constexpr util::float4 placeholderColor = { 0.18f, 0.18f, 0.2f, 1.0f };
+
+  Pipeline() = default;
+  ~Pipeline() { destroy(); }
+
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+  Pipeline(Pipeline&&) = default;
+  Pipeline& operator=(Pipeline&&) = default;
+
+  bool setup(SetupArgs& info)
+  {
+    info.normalize();
+
+    auto missingLayers = checkLayers(info.layers);
+    if (missingLayers.size() > 0)
+    {
+      util::println("Layers not found");
+      for (const auto& l : missingLayers)
+      {
+        util::println(l);
+      }
+      return false;
+    }
+
+    // instance
+    vk::ApplicationInfo appInfo{
+      .pApplicationName = info.appName.c_str(),
+      .apiVersion = VK_API_VERSION_1_3,
+    };
+
+    _instance = vk::createInstanceUnique({
+      .pApplicationInfo = &appInfo,
+      .enabledLayerCount = static_cast<uint32_t>(info.layers.size()),
+      .ppEnabledLayerNames = info.layers.data(),
+      .enabledExtensionCount = static_cast<uint32_t>(info.instanceExtensions.size()),
+      .ppEnabledExtensionNames = info.instanceExtensions.data(),
+    });
+
+    // debug messenger
+    if (info.enableValidationLayers)
+    {
+      VkDebugUtilsMessengerCreateInfoEXT info = {};
+      info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+      info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+      info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+      info.pfnUserCallback = debugCallback;
+
+      if (CreateDebugUtilsMessengerEXT(*_instance, &info, nullptr, &_debugMessenger) != VK_SUCCESS)
+      {
+        std::cerr << "Failed to set up debug messenger!" << std::endl;
+        return false;
+      }
+    }
+
+    // surface. none when headless
+    _headless = info.window == nullptr;
+    if (!_headless)
+    {
+      _surface = info.window->createSurface(*_instance);
+    }
+
+    // physical device
+    {
+      const auto physicalDevice = selectPhysicalDevice(_instance->enumeratePhysicalDevices(), _surface, info.deviceExtensions, info.presentPolicy);
+      if (!physicalDevice)
+      {
+        std::cerr << "Failed to find a suitable physical device" << std::endl;
+        return false;
+      }
+      _physicalDevice = *physicalDevice;
+
+      const auto queues = selectQueues(_physicalDevice, _surface);
+      _queueFamilyIndex = queues->graphicsFamily;
+      _transferQueueFamilyIndex = queues->transferFamily;
+      _transferQueueIndex = queues->transferIndex;
+
+      util::println("device: {}", _physicalDevice.getProperties().deviceName.data());
+    }
+
+    // logical device
+    {
+      const std::array<float, 2> queuePriorities = { 1, 1 };
+      std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos = {
+        vk::DeviceQueueCreateInfo{
+          .queueFamilyIndex = _queueFamilyIndex,
+          .queueCount = _transferQueueFamilyIndex == _queueFamilyIndex ? _transferQueueIndex + 1 : 1,
+          .pQueuePriorities = queuePriorities.data(),
+        },
+      };
+      if (_transferQueueFamilyIndex != _queueFamilyIndex)
+      {
+        deviceQueueCreateInfos.push_back({
+          .queueFamilyIndex = _transferQueueFamilyIndex,
+          .queueCount = 1,
+          .pQueuePriorities = queuePriorities.data(),
+        });
+      }
+
+      // selectPhysicalDevice only picks devices that support these
+      vk::PhysicalDeviceFeatures deviceFeatures = {};
+      auto vulkan12Features = requiredVulkan12Features();
+
+      _device = _physicalDevice.createDeviceUnique({
+        .pNext = &vulkan12Features,
+        .flags = vk::DeviceCreateFlags(),
+        .queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+        .pQueueCreateInfos = deviceQueueCreateInfos.data(),
+        .enabledLayerCount = static_cast<uint32_t>(info.layers.size()),
+        .ppEnabledLayerNames = info.layers.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(info.deviceExtensions.size()),
+        .ppEnabledExtensionNames = info.deviceExtensions.data(),
+        .pEnabledFeatures = &deviceFeatures,
+      });
+
+      _graphicsQueue = _device->getQueue(_queueFamilyIndex, 0);
+      _transferQueue = _device->getQueue(_transferQueueFamilyIndex, _transferQueueIndex);
+    }
+
+    // timestamps: upload begin/end and render begin/end of every frame in flight
+    {
+      const auto props = _physicalDevice.getQueueFamilyProperties();
+      const auto timestampMask = [](uint32_t validBits) {
+        return validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+      };
+      _graphicsTimestampMask = timestampMask(props[_queueFamilyIndex].timestampValidBits);
+      _transferTimestampMask = timestampMask(props[_transferQueueFamilyIndex].timestampValidBits);
+      _timestampPeriod = _physicalDevice.getProperties().limits.timestampPeriod;
+
+      const auto queryCount = queriesPerFrame * std::max(info.framesInFlight, 1u);
+      _queryPool = _device->createQueryPoolUnique({
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = queryCount,
+      });
+      _device->resetQueryPool(*_queryPool, 0, queryCount);
+      _frameCounter = 0;
+    }
+
+    // command buffer
+    _commandPool = _device->createCommandPoolUnique({
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = _queueFamilyIndex,
+    });
+    {
+      const auto commandBuffers = _device->allocateCommandBuffers({
+        .commandPool = *_commandPool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = std::max(info.framesInFlight, 1u),
+      });
+      _frames.resize(commandBuffers.size());
+      for (size_t i = 0; i < _frames.size(); i++)
+      {
+        _frames[i].commandBuffer = commandBuffers[i];
+      }
+    }
+    _transferCommandPool = _device->createCommandPoolUnique({
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = _transferQueueFamilyIndex,
+    });
+    {
+      const auto commandBuffers = _device->allocateCommandBuffers({
+        .commandPool = *_transferCommandPool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = static_cast<uint32_t>(_frames.size()),
+      });
+      for (size_t i = 0; i < _frames.size(); i++)
+      {
+        _frames[i].transferCommandBuffer = commandBuffers[i];
+      }
+    }
+
+    // offscreen images standing in for the swapchain, one per frame in flight
+    if (_headless)
+    {
+      _colorFormat = vk::Format::eB8G8R8A8Unorm;
+      _swapchainExtent = vk::Extent2D{ .width = info.width, .height = info.height };
+      for (size_t i = 0; i < _frames.size(); i++)
+      {
+        auto image = _device->createImageUnique({
+          .imageType = vk::ImageType::e2D,
+          .format = _colorFormat,
+          .extent = { _swapchainExtent.width, _swapchainExtent.height, 1 },
+          .mipLevels = 1,
+          .arrayLayers = 1,
+          .samples = vk::SampleCountFlagBits::e1,
+          .tiling = vk::ImageTiling::eOptimal,
+          .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+          .sharingMode = vk::SharingMode::eExclusive,
+          .initialLayout = vk::ImageLayout::eUndefined,
+        });
+        const auto memReqs = _device->getImageMemoryRequirements(*image);
+        auto memory = _device->allocateMemoryUnique({
+          .allocationSize = memReqs.size,
+          .memoryTypeIndex = common::findMemoryType(_physicalDevice, memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal),
+        });
+        _device->bindImageMemory(*image, *memory, 0);
+        _swapchainImages.push_back(*image);
+        _offscreenImages.push_back(std::move(image));
+        _offscreenMemories.push_back(std::move(memory));
+      }
+    }
+    // swapchain
+    else
+    {
+      // the device was selected with a usable format
+      const auto surfaceFormat = *chooseSurfaceFormat(_physicalDevice.getSurfaceFormatsKHR(_surface));
+      _colorFormat = surfaceFormat.format;
+      const auto colorSpace = surfaceFormat.colorSpace;
+      const auto presentMode = choosePresentMode(_physicalDevice.getSurfacePresentModesKHR(_surface), info.presentPolicy);
+      util::println("present mode: {}", vk::to_string(presentMode));
+
+      const auto capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface);
+      _swapchainExtent = capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()
+        ? capabilities.currentExtent
+        : vk::Extent2D{
+            .width = std::clamp(info.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
+            .height = std::clamp(info.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height),
+          };
+
+      auto imageCount = capabilities.minImageCount + 1;
+      if (capabilities.maxImageCount > 0 && capabilities.maxImageCount < imageCount)
+      {
+        imageCount = capabilities.maxImageCount;
+      }
+
+      _swapchain = _device->createSwapchainKHRUnique({
+        .surface = _surface,
+        .minImageCount = imageCount,
+        .imageFormat = _colorFormat,
+        .imageColorSpace = colorSpace,
+        .imageExtent = _swapchainExtent,
+        .imageArrayLayers = 1,
+        .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+        .imageSharingMode = vk::SharingMode::eExclusive,
+        .preTransform = capabilities.currentTransform,
+        .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
+        .presentMode = presentMode,
+        .clipped = VK_TRUE,
+        .oldSwapchain = VK_NULL_HANDLE,
+      });
+
+      _swapchainImages = _device->getSwapchainImagesKHR(*_swapchain);
+    }
+
+    // image views
+    {
+      for (const auto& image : _swapchainImages)
+      {
+        _swapchainImageViews.emplace_back(_device->createImageViewUnique({
+          .image = image,
+          .viewType = vk::ImageViewType::e2D,
+          .format = _colorFormat,
+          .components = {
+            .r = vk::ComponentSwizzle::eIdentity,
+            .g = vk::ComponentSwizzle::eIdentity,
+            .b = vk::ComponentSwizzle::eIdentity,
+            .a = vk::ComponentSwizzle::eIdentity,
+          },
+          .subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+          },
+        }));
+      }
+    }
+
+    // synchronization
+    // the acquire semaphore and fence belong to a frame in flight. the render finished semaphore belongs to a
+    // swapchain image because presentation may still wait on it when the frame slot comes around again
+    for (auto& frame : _frames)
+    {
+      frame.imageAcquired = _device->createSemaphoreUnique({});
+      frame.fence = _device->createFenceUnique({
+        .flags = vk::FenceCreateFlagBits::eSignaled,
+      });
+    }
+    for (size_t i = 0; i < _swapchainImages.size() && !_headless; i++)
+    {
+      _renderFinishedSemaphores.emplace_back(_device->createSemaphoreUnique({}));
+    }
+
+    // uploads signal _uploadTimeline and draws wait on it; draws signal _renderTimeline,
+    // and the next upload waits on it before overwriting textures that are still sampled
+    {
+      const auto timelineInfo = vk::SemaphoreTypeCreateInfo{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0,
+      };
+      _uploadTimeline = _device->createSemaphoreUnique({ .pNext = &timelineInfo });
+      _renderTimeline = _device->createSemaphoreUnique({ .pNext = &timelineInfo });
+      _uploadValue = 0;
+      _renderValue = 0;
+    }
+
+    // render pass
+    {
+      std::array<vk::AttachmentDescription, 1> attachmentDescriptions{
+        // color
+        vk::AttachmentDescription{
+          .format = _colorFormat,
+          .samples = vk::SampleCountFlagBits::e1,
+          .loadOp = vk::AttachmentLoadOp::eDontCare,
+          .storeOp = vk::AttachmentStoreOp::eStore,
+          .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
+          .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
+          .initialLayout = vk::ImageLayout::eUndefined,
+          .finalLayout = _headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
+        },
+      };
+
+      const auto colorReference = vk::AttachmentReference{
+        .attachment = 0,
+        .layout = vk::ImageLayout::eColorAttachmentOptimal,
+      };
+
+      const auto subpass = vk::SubpassDescription{
+        .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorReference,
+      };
+
+      _renderPass = _device->createRenderPassUnique({
+        .attachmentCount = attachmentDescriptions.size(),
+        .pAttachments = attachmentDescriptions.data(),
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+      });
+    }
+
+    // pipeline
+    {
+      _vertShaderModule = createShaderModule(*_device, shader::paneVert);
+      _fragShaderModule = createShaderModule(*_device, shader::paneFrag);
+
+      std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfo = {
+        vk::PipelineShaderStageCreateInfo{
+          .stage = vk::ShaderStageFlagBits::eVertex,
+          .module = *_vertShaderModule,
+          .pName = "main",
+        },
+        vk::PipelineShaderStageCreateInfo{
+          .stage = vk::ShaderStageFlagBits::eFragment,
+          .module = *_fragShaderModule,
+          .pName = "main",
+        }
+      };
+
+      const auto vertexInputInfo = vk::PipelineVertexInputStateCreateInfo{
+        .vertexBindingDescriptionCount = 0,
+        .vertexAttributeDescriptionCount = 0,
+      };
+
+      const auto inputAssembly = vk::PipelineInputAssemblyStateCreateInfo{
+        .topology = vk::PrimitiveTopology::eTriangleList,
+        .primitiveRestartEnable = false,
+      };
+
+      const auto rasterizer = vk::PipelineRasterizationStateCreateInfo{
+        .depthClampEnable = false,
+        .rasterizerDiscardEnable = false,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eBack,
+        .frontFace = vk::FrontFace::eClockwise,
+        .depthBiasEnable = false,
+        .lineWidth = 1.0,
+      };
+
+      const auto multisampling = vk::PipelineMultisampleStateCreateInfo{
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = vk::False,
+      };
+
+      {
+        const auto limits = _physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>().get<vk::PhysicalDeviceVulkan12Properties>();
+        const auto textureLimit = std::min({
+          limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+          limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+          limits.maxDescriptorSetUpdateAfterBindSampledImages,
+          limits.maxDescriptorSetUpdateAfterBindSamplers,
+        });
+        _slotCount = std::min(maxContentCount, textureLimit / common::maxPlaneCount);
+        _freeSlots.clear();
+        for (auto slot = _slotCount; slot > 0; slot--)
+        {
+          _freeSlots.push_back(slot - 1);
+        }
+
+        std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+          vk::DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+          },
+          vk::DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = textureCount(),
+            .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          }
+        };
+
+        // slots of unregistered contents keep stale descriptors. they are never sampled
+        const std::array<vk::DescriptorBindingFlags, 2> bindingFlags = {
+          vk::DescriptorBindingFlags{},
+          vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending,
+        };
+        const auto bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo{
+          .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+          .pBindingFlags = bindingFlags.data(),
+        };
+        _descriptorSetLayout = _device->createDescriptorSetLayoutUnique({
+          .pNext = &bindingFlagsInfo,
+          .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+          .bindingCount = static_cast<uint32_t>(bindings.size()),
+          .pBindings = bindings.data(),
+        });
+
+        auto descriptorSetLayout = *_descriptorSetLayout;
+        _pipelineLayout = _device->createPipelineLayoutUnique({
+          .setLayoutCount = 1,
+          .pSetLayouts = &descriptorSetLayout,
+        });
+      }
+
+      const auto dynamicStates = std::vector<vk::DynamicState>{
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+      };
+      const auto dynamicState = vk::PipelineDynamicStateCreateInfo{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data(),
+      };
+
+      const auto colorBlendingAttachment = vk::PipelineColorBlendAttachmentState{
+        .blendEnable = false,
+        .srcColorBlendFactor = vk::BlendFactor::eOne,
+        .dstColorBlendFactor = vk::BlendFactor::eZero,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
+      };
+
+      const auto colorBlending = vk::PipelineColorBlendStateCreateInfo{
+        .logicOpEnable = false,
+        .logicOp = vk::LogicOp::eCopy,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendingAttachment,
+        .blendConstants = {},
+      };
+
+      const auto viewportState = vk::PipelineViewportStateCreateInfo{
+        .viewportCount = 1,
+        .scissorCount = 1,
+      };
+
+      // a warm cache skips the driver's shader compilation, the bulk of the startup time
+      _pipelineCache.setup(_device, _physicalDevice, info.pipelineCachePath);
+      auto [result, pipeline] = _device->createGraphicsPipelineUnique(
+        _pipelineCache.get(),
+        {
+          .stageCount = shaderStageCreateInfo.size(),
+          .pStages = shaderStageCreateInfo.data(),
+          .pVertexInputState = &vertexInputInfo,
+          .pInputAssemblyState = &inputAssembly,
+          .pViewportState = &viewportState,
+          .pRasterizationState = &rasterizer,
+          .pMultisampleState = &multisampling,
+          .pColorBlendState = &colorBlending,
+          .pDynamicState = &dynamicState,
+          .layout = *_pipelineLayout,
+          .renderPass = *_renderPass,
+          .subpass = 0,
+        });
+      switch (result)
+      {
+        case vk::Result::eSuccess:
+          break;
+        case vk::Result::ePipelineCompileRequiredEXT:
+          // something meaningfull here
+          break;
+        default:
+          assert(false); // should never happen
+      }
+      _pipeline = std::move(pipeline);
+      _pipelineCache.save(_device);
+    }
+
+    // framebuffers
+    _frameBuffers.resize(_swapchainImageViews.size());
+    std::transform(_swapchainImageViews.begin(), _swapchainImageViews.end(), _frameBuffers.begin(), [this](const auto& view) {
+      auto viewHandle = *view;
+      return _device->createFramebufferUnique({
+        .renderPass = *_renderPass,
+        .attachmentCount = 1,
+        .pAttachments = &viewHandle,
+        .width = _swapchainExtent.width,
+        .height = _swapchainExtent.height,
+        .layers = 1,
+      });
+    });
+
+    // descriptor set
+    {
+      std::array<vk::DescriptorPoolSize, 2> poolSizes{
+        vk::DescriptorPoolSize{ .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1 },
+        vk::DescriptorPoolSize{ .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = textureCount() },
+      };
+
+      _descriptorPool = _device->createDescriptorPoolUnique({
+        .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        .maxSets = 2,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes.data(),
+      });
+
+      auto descriptorSetLayout = *_descriptorSetLayout;
+      _descriptorSets = _device->allocateDescriptorSets({
+        .descriptorPool = *_descriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &descriptorSetLayout,
+      });
+    }
+
+    // staging, sized to the contents as they are registered, resized and unregistered
+    _hashTiles = info.hashTiles;
+    _waitForFrames = info.waitForFrames;
+    _mipmaps = info.mipmaps;
+    _releaseHiddenContents = info.releaseHiddenContents;
+    _decodeThreadBudget = info.decodeThreadBudget > 0 ? info.decodeThreadBudget : std::max(1u, std::thread::hardware_concurrency());
+    _staging.setup(_device, _physicalDevice, 0);
+
+    createViewports();
+
+    return true;
+  }
+
+  void createViewports()
+  {
+    _viewports.add({ 0.1, 0.1, 0.3, 0.6, util::float4{ 0.4, 0.6, 0.2, 1.0 } });
+    _viewports.add({ 0.5, 0, 0.5, 1, util::float4{ 0.2, 0.6, 0.8, 1.0 } });
+    _paneContents.resize(_viewports.size());
+
+    // one array of panes per frame in flight. a frame selects its array with firstInstance
+    _paneCapacity = std::max<uint32_t>(_viewports.size(), 1);
+    const auto size = sizeof(PaneData) * _paneCapacity * _frames.size();
+    _paneBuffer = _device->createBufferUnique({
+      .size = size,
+      .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+      .sharingMode = vk::SharingMode::eExclusive,
+    });
+
+    const auto memRequirements = _device->getBufferMemoryRequirements(*_paneBuffer);
+    _paneMemory = _device->allocateMemoryUnique(
+      { .allocationSize = memRequirements.size,
+        .memoryTypeIndex = common::findMemoryType(
+          _physicalDevice,
+          memRequirements.memoryTypeBits,
+          vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent) });
+    _device->bindBufferMemory(*_paneBuffer, *_paneMemory, 0);
+    _mappedPanes = static_cast<PaneData*>(_device->mapMemory(*_paneMemory, 0, size));
+
+    const auto bufferInfo = vk::DescriptorBufferInfo{
+      .buffer = *_paneBuffer,
+      .offset = 0,
+      .range = size,
+    };
+    const auto write = vk::WriteDescriptorSet{
+      .dstSet = _descriptorSets.front(),
+      .dstBinding = 0,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eStorageBuffer,
+      .pBufferInfo = &bufferInfo,
+    };
+    _device->updateDescriptorSets(1, &write, 0, nullptr);
+  }
+
+  // fills the pane array of the current frame. returns the instance of its first pane
+  uint32_t writePanes()
+  {
+    const auto first = static_cast<uint32_t>(_frameIndex) * _paneCapacity;
+    for (uint32_t i = 0; i < _viewports.size(); i++)
+    {
+      auto pane = _viewports.getPaneData(i);
+      if (const auto it = _contents.find(_paneContents[i]); it != _contents.end())
+      {
+        const auto& t = it->second;
+        pane.textureIndex = t.slot * common::maxPlaneCount;
+        pane.pixelFormat = static_cast<uint32_t>(t.format);
+        pane.colorMatrix = static_cast<uint32_t>(t.colorSpace.matrix);
+        pane.fullRange = t.colorSpace.fullRange;
+      }
+      else if (_openingContents.contains(_paneContents[i]))
+      {
+        pane.color = placeholderColor;
+      }
+      _mappedPanes[first + i] = pane;
+    }
+    return first;
+  }
+
+  void recordCommand(const vk::CommandBuffer& commandBuffer, const uint32_t currentIndex)
+  {
+    commandBuffer.beginRenderPass(
+      {
+        .renderPass = *_renderPass,
+        .framebuffer = *_frameBuffers[currentIndex],
+        .renderArea = {
+          .offset = { 0, 0 },
+          .extent = _swapchainExtent,
+        },
+      },
+      vk::SubpassContents::eInline);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *_pipeline);
+    commandBuffer.bindDescriptorSets(
+      vk::PipelineBindPoint::eGraphics,
+      *_pipelineLayout,
+      0,
+      1,
+      _descriptorSets.data(),
+      0,
+      nullptr);
+
+    // every pane is one instance. pane.vert places it from the pane storage buffer
+    commandBuffer.setViewport(0, vk::Viewport{
+                                   .x = 0,
+                                   .y = 0,
+                                   .width = static_cast<float>(_swapchainExtent.width),
+                                   .height = static_cast<float>(_swapchainExtent.height),
+                                   .minDepth = 0,
+                                   .maxDepth = 1,
+                                 });
+    commandBuffer.setScissor(0, vk::Rect2D{ .offset = { 0, 0 }, .extent = _swapchainExtent });
+    commandBuffer.draw(9, static_cast<uint32_t>(_viewports.size()), 0, writePanes());
+
+    commandBuffer.endRenderPass();
+  }
+
+  // copies the rendered image to the capture buffer. the render pass left it in TransferSrcOptimal
+  void recordCapture(const vk::CommandBuffer& commandBuffer, const uint32_t currentIndex)
+  {
+    if (!_captureBuffer)
+    {
+      const auto size = vk::DeviceSize(_swapchainExtent.width) * _swapchainExtent.height * 4;
+      _captureBuffer = _device->createBufferUnique({
+        .size = size,
+        .usage = vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive,
+      });
+      const auto memReqs = _device->getBufferMemoryRequirements(*_captureBuffer);
+      _captureMemory = _device->allocateMemoryUnique({
+        .allocationSize = memReqs.size,
+        .memoryTypeIndex = common::findMemoryType(
+          _physicalDevice,
+          memReqs.memoryTypeBits,
+          vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent),
+      });
+      _device->bindBufferMemory(*_captureBuffer, *_captureMemory, 0);
+      _mappedCapture = static_cast<const uint8_t*>(_device->mapMemory(*_captureMemory, 0, size));
+    }
+
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::PipelineStageFlagBits::eTransfer,
+      {},
+      vk::MemoryBarrier{
+        .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+      },
+      nullptr,
+      nullptr);
+    commandBuffer.copyImageToBuffer(
+      _swapchainImages[currentIndex],
+      vk::ImageLayout::eTransferSrcOptimal,
+      *_captureBuffer,
+      vk::BufferImageCopy{
+        .bufferOffset = 0,
+        .imageSubresource = {
+          .aspectMask = vk::ImageAspectFlagBits::eColor,
+          .mipLevel = 0,
+          .baseArrayLayer = 0,
+          .layerCount = 1,
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { _swapchainExtent.width, _swapchainExtent.height, 1 },
+      });
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eHost,
+      {},
+      vk::MemoryBarrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+      },
+      nullptr,
+      nullptr);
+
+    _captureRequested = false;
+    _captured = true;
+    _captureFrame = _frameIndex;
+  }
+
+  // records the render pass, submits it behind the uploads of update() and presents without waiting for the GPU.
+  // headless frames render into the offscreen image of their slot and are not presented
+  void draw()
+  {
+    DAIA_TRACE_SCOPE("Pipeline::draw");
+    auto& frame = _frames[_frameIndex];
+    const auto& commandBuffer = frame.commandBuffer;
+
+    const auto swapchain = *_swapchain;
+    const auto imageAcquiredSemaphore = *frame.imageAcquired;
+
+    uint32_t currentIndex;
+    {
+      DAIA_TRACE_SCOPE("acquire");
+      ScopedTimer timer(frame.stats.acquire);
+      currentIndex = _headless
+        ? static_cast<uint32_t>(_frameIndex)
+        : _device->acquireNextImageKHR(swapchain, std::numeric_limits<uint64_t>::max(), imageAcquiredSemaphore, nullptr).value;
+    }
+    const auto renderFinishedSemaphore = _headless ? vk::Semaphore{} : *_renderFinishedSemaphores[currentIndex];
+
+    std::optional<ScopedTimer> recordTimer(std::in_place, frame.stats.drawRecord);
+    const auto query = static_cast<uint32_t>(_frameIndex) * queriesPerFrame;
+    frame.renderTimed = _graphicsTimestampMask != 0;
+    if (frame.renderTimed)
+    {
+      commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *_queryPool, query + 2);
+    }
+    recordCommand(commandBuffer, currentIndex);
+    if (frame.renderTimed)
+    {
+      commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *_queryPool, query + 3);
+    }
+    if (_captureRequested)
+    {
+      recordCapture(commandBuffer, currentIndex);
+    }
+    commandBuffer.end();
+
+    _device->resetFences(*frame.fence);
+
+    // the binary semaphores ignore their values. headless frames only use the timelines
+    const uint32_t semaphoreCount = _headless ? 1 : 2;
+    const std::array<vk::Semaphore, 2> waitSemaphores = { *_uploadTimeline, imageAcquiredSemaphore };
+    const std::array<uint64_t, 2> waitValues = { _uploadValue, 0 };
+    const std::array<vk::PipelineStageFlags, 2> waitDestinationStageMasks = {
+      vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader, // mip levels are blitted before the render pass
+      vk::PipelineStageFlags{ vk::PipelineStageFlagBits::eColorAttachmentOutput },
+    };
+    const std::array<vk::Semaphore, 2> signalSemaphores = { *_renderTimeline, renderFinishedSemaphore };
+    const std::array<uint64_t, 2> signalValues = { ++_renderValue, 0 };
+    const auto timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo{
+      .waitSemaphoreValueCount = semaphoreCount,
+      .pWaitSemaphoreValues = waitValues.data(),
+      .signalSemaphoreValueCount = semaphoreCount,
+      .pSignalSemaphoreValues = signalValues.data(),
+    };
+    _graphicsQueue.submit(
+      { {
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = semaphoreCount,
+        .pWaitSemaphores = waitSemaphores.data(),
+        .pWaitDstStageMask = waitDestinationStageMasks.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = semaphoreCount,
+        .pSignalSemaphores = signalSemaphores.data(),
+      } },
+      *frame.fence);
+    recordTimer.reset();
+
+    if (_headless)
+    {
+      _frameIndex = (_frameIndex + 1) % _frames.size();
+      return;
+    }
+
+    DAIA_TRACE_SCOPE("present");
+    ScopedTimer presentTimer(frame.stats.present);
+    const auto result = _graphicsQueue.presentKHR({
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &renderFinishedSemaphore,
+      .swapchainCount = 1,
+      .pSwapchains = &swapchain,
+      .pImageIndices = &currentIndex,
+    });
+    switch (result)
+    {
+      case vk::Result::eSuccess:
+        break;
+      case vk::Result::eSuboptimalKHR:
+        std::cout << "vk::Queue::presentKHR returned vk::Result::eSuboptimalKHR !\n";
+        break;
+      default:
+        assert(false); // an unexpected result is returned !
+    }
+
+    _frameIndex = (_frameIndex + 1) % _frames.size();
+  }
+
+  // copies the next frame drawn into host memory. headless only
+  void requestCapture()
+  {
+    _captureRequested = _headless;
+  }
+
+  // the frame captured by the last draw() as RGBA, waiting for it to finish rendering. call before the next draw()
+  std::optional<util::Image> takeCapture()
+  {
+    if (!_captured)
+    {
+      return std::nullopt;
+    }
+    _captured = false;
+
+    while (vk::Result::eTimeout == _device->waitForFences({ *_frames[_captureFrame].fence }, true, std::numeric_limits<uint64_t>::max()))
+      ;
+
+    const auto pixelCount = size_t(_swapchainExtent.width) * _swapchainExtent.height;
+    std::vector<uint8_t> pixels(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+      // B8G8R8A8 to RGBA
+      pixels[i * 4 + 0] = _mappedCapture[i * 4 + 2];
+      pixels[i * 4 + 1] = _mappedCapture[i * 4 + 1];
+      pixels[i * 4 + 2] = _mappedCapture[i * 4 + 0];
+      pixels[i * 4 + 3] = _mappedCapture[i * 4 + 3];
+    }
+    return util::Image(_swapchainExtent.width, _swapchainExtent.height, std::move(pixels));
+  }
+
+  bool headless() const
+  {
+    return _headless;
+  }
+
+  // finishes the stats of the frame that last used this slot, whose fence has been waited on, and starts new ones
+  void collectStats(size_t frameIndex)
+  {
+    auto& frame = _frames[frameIndex];
+    const auto first = static_cast<uint32_t>(frameIndex) * queriesPerFrame;
+    const auto elapsed = [this, first](uint32_t query, uint64_t mask) {
+      std::array<uint64_t, 2> ticks = {};
+      const auto result = _device->getQueryPoolResults(*_queryPool, first + query, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+      return result == vk::Result::eSuccess ? ((ticks[1] - ticks[0]) & mask) * _timestampPeriod / 1e6 : 0.0;
+    };
+
+    if (frame.stats.frame != 0)
+    {
+      if (frame.uploadTimed)
+      {
+        frame.stats.gpuUpload = elapsed(0, _transferTimestampMask);
+      }
+      if (frame.renderTimed)
+      {
+        frame.stats.gpuRender = elapsed(2, _graphicsTimestampMask);
+      }
+      _stats = frame.stats;
+      _device->resetQueryPool(*_queryPool, first, queriesPerFrame);
+    }
+
+    frame.stats = FrameStats{ .frame = ++_frameCounter };
+    frame.uploadTimed = false;
+    frame.renderTimed = false;
+  }
+
+  // waits until this frame slot is free, then uploads the contents on the transfer queue
+  void update(double globalTime)
+  {
+    DAIA_TRACE_SCOPE("Pipeline::update");
+    updateOpeningContents();
+    resizeContents();
+    auto& frame = _frames[_frameIndex];
+
+    double fenceWait = 0;
+    {
+      DAIA_TRACE_SCOPE("wait frame fence");
+      ScopedTimer timer(fenceWait);
+      while (vk::Result::eTimeout == _device->waitForFences({ *frame.fence }, true, std::numeric_limits<uint64_t>::max()))
+        ;
+    }
+    _staging.release(frame.stagingMark);
+    collectStats(_frameIndex);
+    frame.stats.fenceWait = fenceWait;
+
+    // the fence covers the transfer command buffer too: the draw of this slot waited on its upload
+    frame.commandBuffer.reset();
+    frame.commandBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+    const auto& commandBuffer = frame.transferCommandBuffer;
+    commandBuffer.reset();
+    commandBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+    _toTransferBarriers.clear();
+    _uploadCopies.clear();
+    _toShaderBarriers.clear();
+    _mipmapTextures.clear();
+
+    updateVisibility(globalTime);
+
+    for (auto& [key, t] : _contents)
+    {
+      auto& [content, layout, format, colorSpace, slot, planes, tiles, uploaded, suspended, resized, stale] = t;
+
+      // hidden contents neither decode nor upload
+      const auto paneSize = visiblePaneSize(key);
+      if (suspended || !paneSize)
+      {
+        continue;
+      }
+
+      bool updated;
+      {
+        DAIA_TRACE_SCOPE("Content::update");
+        ScopedTimer timer(frame.stats.contentUpdate);
+        updated = content->update({
+          .time = globalTime,
+          .waitForFrames = _waitForFrames,
+          .width = (*paneSize)[0],
+          .height = (*paneSize)[1],
+        });
+      }
+      // a resized content writes its current frame again into the new textures, a stale one retries its upload
+      if (!updated && !resized && !stale)
+      {
+        continue;
+      }
+      if (texturesOutdated(t))
+      {
+        // staging regions of this frame are already taken, so the textures are recreated at the start of the next update
+        resized = true;
+        continue;
+      }
+      resized = false;
+
+      // cpu texture upload. the content writes straight into its staging region, then every plane is copied from its offset
+      const auto staging = _staging.allocate(layout.size);
+      if (!staging)
+      {
+        // the content already moved on to this frame and may not produce another one, e.g. when paused
+        if (!stale)
+        {
+          util::println("staging buffer is full, upload deferred");
+        }
+        stale = true;
+        continue;
+      }
+
+      // only the changed regions are copied. the first upload and retried ones cover the whole frame,
+      // since regions changed by frames that were never uploaded are not known anymore
+      {
+        DAIA_TRACE_SCOPE("Content::write");
+        ScopedTimer timer(frame.stats.stagingWrite);
+        if (!content->write({ staging->data, layout.size }))
+        {
+          // the frame does not fit the layout of the textures. written again after resizeContents() checked them
+          util::println("frame of {} does not fit its textures, upload skipped", key);
+          resized = true;
+          continue;
+        }
+
+        const auto regions = content->changedRegions();
+        if (!uploaded || stale || regions.empty())
+        {
+          tiles.markAll();
+        }
+        stale = false;
+        for (const auto& region : regions)
+        {
+          tiles.mark(region);
+        }
+        if (_hashTiles)
+        {
+          tiles.dropUnchanged(staging->data);
+        }
+      }
+
+      const auto copyCount = _uploadCopies.size();
+      tiles.flush([&](const common::Region& region) {
+        for (uint32_t i = 0; i < layout.count; i++)
+        {
+          const auto& plane = layout.planes[i];
+          const auto area = DirtyTiles::planeRegion(plane, region);
+          frame.stats.uploadBytes += uint64_t(area.width) * area.height * plane.bytesPerPixel;
+          _uploadCopies.push_back({
+            .image = *planes[i].image,
+            .region = vk::BufferImageCopy{
+              .bufferOffset = staging->offset + plane.offset + area.y * plane.rowPitch() + area.x * plane.bytesPerPixel,
+              .bufferRowLength = plane.width,
+              .bufferImageHeight = plane.height,
+              .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+              },
+              .imageOffset = { static_cast<int32_t>(area.x), static_cast<int32_t>(area.y), 0 },
+              .imageExtent = { area.width, area.height, 1 },
+            },
+          });
+        }
+      });
+      if (_uploadCopies.size() == copyCount)
+      {
+        // same frame as before
+        continue;
+      }
+
+      for (uint32_t i = 0; i < layout.count; i++)
+      {
+        const auto image = *planes[i].image;
+
+        _toTransferBarriers.push_back(vk::ImageMemoryBarrier{
+          .srcAccessMask = {},
+          .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+          .oldLayout = uploaded ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+          .newLayout = vk::ImageLayout::eTransferDstOptimal,
+          .image = image,
+          .subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 } });
+
+        _toShaderBarriers.push_back(vk::ImageMemoryBarrier{
+          .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+          .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+          .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+          .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+          .image = image,
+          .subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 } });
+
+        if (planes[i].mipLevels > 1)
+        {
+          _mipmapTextures.push_back(&planes[i]);
+        }
+      }
+      uploaded = true;
+    }
+
+    ScopedTimer uploadTimer(frame.stats.uploadRecord);
+    frame.stats.uploadCopies = static_cast<uint32_t>(_uploadCopies.size());
+    frame.uploadTimed = !_uploadCopies.empty() && _transferTimestampMask != 0;
+    const auto query = static_cast<uint32_t>(_frameIndex) * queriesPerFrame;
+
+    // one barrier batch before and after all copies of the frame.
+    // only transfer stages are valid here; ordering against the graphics queue comes from the timeline semaphores
+    if (!_uploadCopies.empty())
+    {
+      if (frame.uploadTimed)
+      {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *_queryPool, query);
+      }
+
+      commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        nullptr,
+        nullptr,
+        _toTransferBarriers);
+
+      for (const auto& copy : _uploadCopies)
+      {
+        commandBuffer.copyBufferToImage(_staging.buffer(), copy.image, vk::ImageLayout::eTransferDstOptimal, copy.region);
+      }
+
+      commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eBottomOfPipe,
+        {},
+        nullptr,
+        nullptr,
+        _toShaderBarriers);
+
+      if (frame.uploadTimed)
+      {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *_queryPool, query + 1);
+      }
+    }
+
+    commandBuffer.end();
+    frame.stagingMark = _staging.mark();
+
+    recordMipmaps(frame.commandBuffer);
+
+    if (_uploadCopies.empty())
+    {
+      return;
+    }
+
+    // wait until the last draw stopped sampling, signal the value the next draw waits on
+    const auto renderTimeline = *_renderTimeline;
+    const auto uploadTimeline = *_uploadTimeline;
+    const uint64_t waitValue = _renderValue;
+    const uint64_t signalValue = ++_uploadValue;
+    const auto waitStageMask = vk::PipelineStageFlags{ vk::PipelineStageFlagBits::eTransfer };
+    const auto timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo{
+      .waitSemaphoreValueCount = 1,
+      .pWaitSemaphoreValues = &waitValue,
+      .signalSemaphoreValueCount = 1,
+      .pSignalSemaphoreValues = &signalValue,
+    };
+    _transferQueue.submit(
+      { {
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &renderTimeline,
+        .pWaitDstStageMask = &waitStageMask,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &uploadTimeline,
+      } },
+      nullptr);
+  }
+
+  // stats of the last frame whose gpu work has finished
+  const FrameStats& stats() const
+  {
+    return _stats;
+  }
+
+  // a content that is still opening shows a placeholder in its pane and gets its textures once it is ready
+  bool registerContent(const std::string& key, std::shared_ptr<content::Content> content)
+  {
+    if (_contents.contains(key) || _openingContents.contains(key))
+    {
+      return false;
+    }
+    if (_freeSlots.empty())
+    {
+      util::println("too many contents, {} is not registered", key);
+      return false;
+    }
+
+    // the first pane without a content shows it
+    if (const auto pane = std::find(_paneContents.begin(), _paneContents.end(), std::string()); pane != _paneContents.end())
+    {
+      *pane = key;
+    }
+
+    if (content->openState() != content::OpenState::eReady)
+    {
+      _openingContents[key] = std::move(content);
+      return true;
+    }
+
+    // the descriptor set and the staging buffer may be in use by frames in flight
+    _device->waitIdle();
+    if (!setupContent(key, std::move(content)))
+    {
+      return false;
+    }
+    resizeStaging();
+    rebalanceDecodeThreads();
+    return true;
+  }
+
+  // sets up the contents that finished opening since the last frame, all under one idle wait
+  void updateOpeningContents()
+  {
+    std::vector<std::pair<std::string, std::shared_ptr<content::Content>>> ready;
+    for (auto it = _openingContents.begin(); it != _openingContents.end();)
+    {
+      const auto state = it->second->openState();
+      if (state == content::OpenState::eOpening)
+      {
+        ++it;
+        continue;
+      }
+
+      if (state == content::OpenState::eFailed)
+      {
+        util::println("failed to open content: {}", it->first);
+        std::replace(_paneContents.begin(), _paneContents.end(), it->first, std::string());
+      }
+      else
+      {
+        ready.emplace_back(it->first, std::move(it->second));
+      }
+      it = _openingContents.erase(it);
+    }
+
+    if (ready.empty())
+    {
+      return;
+    }
+
+    _device->waitIdle();
+    for (auto& [key, content] : ready)
+    {
+      if (!setupContent(key, std::move(content)))
+      {
+        util::println("failed to open content: {}", key);
+        std::replace(_paneContents.begin(), _paneContents.end(), key, std::string());
+      }
+    }
+    resizeStaging();
+    rebalanceDecodeThreads();
+  }
+
+  // room for every shown content to upload in each frame in flight. call while the device is idle
+  void resizeStaging()
+  {
+    _staging.resize(_device, _physicalDevice, requiredStagingSize() * _frames.size());
+  }
+
+  // creates the textures of a ready content and binds them to a free slot.
+  // call while the device is idle, then resizeStaging() once for all the contents set up
+  bool setupContent(const std::string& key, std::shared_ptr<content::Content> content)
+  {
+    if (_freeSlots.empty())
+    {
+      util::println("too many contents, {} is not registered", key);
+      return false;
+    }
+
+    util::println("register content: {}", key);
+
+    // the pane size lets the content pick its output size before its textures are created. a content no pane shows
+    // starts at the smallest size and is resized once a pane shows it
+    const auto paneSize = visiblePaneSize(key).value_or(util::float2{ 1, 1 });
+    content->setup({
+      .device = _device,
+      .physicalDevice = _physicalDevice,
+      .width = paneSize[0],
+      .height = paneSize[1],
+    });
+
+    const auto slot = _freeSlots.back();
+    _freeSlots.pop_back();
+    auto& wrapped = _contents[key];
+    wrapped = {
+      .content = content,
+      .slot = slot,
+    };
+    createContentTextures(wrapped);
+
+    return true;
+  }
+
+  // creates the textures of a content for its current size and format. call while the device is idle.
+  // YUV formats get one texture per plane and are converted in pane.frag
+  void createContentTextures(WrappedContent& t)
+  {
+    auto [w, h] = t.content->size();
+    t.format = t.content->format();
+    t.colorSpace = t.content->colorSpace();
+    t.layout = common::planeLayout(t.format, w, h);
+    t.planes = std::vector<common::Texture>(t.layout.count);
+    for (uint32_t i = 0; i < t.layout.count; i++)
+    {
+      const auto& plane = t.layout.planes[i];
+      const auto format = common::Texture::formatFromBytesPerPixel(plane.bytesPerPixel);
+      const auto mipLevels = _mipmaps && supportsMipmaps(format) ? common::Texture::mipLevelCount(plane.width, plane.height) : 1;
+      t.planes[i].setup(_device, _physicalDevice, plane.width, plane.height, format, textureQueueFamilies(), mipLevels);
+    }
+
+    // the planes take the content's slot of the texture array. other slots are untouched
+    std::array<vk::DescriptorImageInfo, common::maxPlaneCount> imageInfos;
+    for (uint32_t i = 0; i < t.layout.count; i++)
+    {
+      imageInfos[i] = t.planes[i].createDescriptorInfo();
+    }
+    const auto write = vk::WriteDescriptorSet{
+      .dstSet = _descriptorSets.front(),
+      .dstBinding = 1,
+      .dstArrayElement = t.slot * common::maxPlaneCount,
+      .descriptorCount = t.layout.count,
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+      .pImageInfo = imageInfos.data(),
+    };
+    _device->updateDescriptorSets(1, &write, 0, nullptr);
+
+    t.tiles.reset(t.layout);
+    t.uploaded = false;
+  }
+
+  // mip chains are built with linear blits. the formats of content textures require that support, but the check keeps
+  // an unusual driver at one level instead of failing
+  bool supportsMipmaps(vk::Format format) const
+  {
+    const auto required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (_physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+  }
+
+  // rebuilds the mip chains of the textures uploaded in this update on the graphics queue, as transfer-only queues cannot blit.
+  // runs before the render pass behind the upload timeline. every level is a linear blit of the one above, level by level
+  // across all textures so each step needs one barrier batch
+  void recordMipmaps(const vk::CommandBuffer& commandBuffer)
+  {
+    if (_mipmapTextures.empty())
+    {
+      return;
+    }
+
+    const auto levels = [](uint32_t base, uint32_t count) {
+      return vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, base, count, 0, 1 };
+    };
+    const auto levelSize = [](const common::Texture* texture, uint32_t level) {
+      return vk::Offset3D{
+        static_cast<int32_t>(std::max(texture->extent.width >> level, 1u)),
+        static_cast<int32_t>(std::max(texture->extent.height >> level, 1u)),
+        1,
+      };
+    };
+
+    // level 0 was left for sampling by the upload. the other levels are overwritten entirely.
+    // the transfer stage in the source scope orders the transitions after the upload timeline wait,
+    // the fragment stage after the previous draws sampling the chain
+    _mipmapBarriers.clear();
+    uint32_t maxLevels = 0;
+    for (const auto* texture : _mipmapTextures)
+    {
+      _mipmapBarriers.push_back(vk::ImageMemoryBarrier{
+        .srcAccessMask = {},
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .image = *texture->image,
+        .subresourceRange = levels(0, 1) });
+      _mipmapBarriers.push_back(vk::ImageMemoryBarrier{
+        .srcAccessMask = {},
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .image = *texture->image,
+        .subresourceRange = levels(1, texture->mipLevels - 1) });
+      maxLevels = std::max(maxLevels, texture->mipLevels);
+    }
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader,
+      vk::PipelineStageFlagBits::eTransfer,
+      {},
+      nullptr,
+      nullptr,
+      _mipmapBarriers);
+
+    for (uint32_t level = 1; level < maxLevels; level++)
+    {
+      _mipmapBarriers.clear();
+      for (const auto* texture : _mipmapTextures)
+      {
+        if (level >= texture->mipLevels)
+        {
+          continue;
+        }
+        commandBuffer.blitImage(
+          *texture->image,
+          vk::ImageLayout::eTransferSrcOptimal,
+          *texture->image,
+          vk::ImageLayout::eTransferDstOptimal,
+          vk::ImageBlit{
+            .srcSubresource = { vk::ImageAspectFlagBits::eColor, level - 1, 0, 1 },
+            .srcOffsets = std::array{ vk::Offset3D{ 0, 0, 0 }, levelSize(texture, level - 1) },
+            .dstSubresource = { vk::ImageAspectFlagBits::eColor, level, 0, 1 },
+            .dstOffsets = std::array{ vk::Offset3D{ 0, 0, 0 }, levelSize(texture, level) },
+          },
+          vk::Filter::eLinear);
+
+        // the source of the next level
+        _mipmapBarriers.push_back(vk::ImageMemoryBarrier{
+          .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+          .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+          .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+          .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+          .image = *texture->image,
+          .subresourceRange = levels(level, 1) });
+      }
+      commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, _mipmapBarriers);
+    }
+
+    _mipmapBarriers.clear();
+    for (const auto* texture : _mipmapTextures)
+    {
+      _mipmapBarriers.push_back(vk::ImageMemoryBarrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+        .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .image = *texture->image,
+        .subresourceRange = levels(0, texture->mipLevels) });
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, _mipmapBarriers);
+  }
+
+  // the content's frame has another size or format than its textures, e.g. after it followed a pane resize
+  static bool texturesOutdated(const WrappedContent& t)
+  {
+    const auto [w, h] = t.content->size();
+    return t.content->format() != t.format || w != t.layout.planes[0].width || h != t.layout.planes[0].height;
+  }
+
+  // recreates the textures of contents whose frame stopped fitting them in the last update,
+  // and resizes the staging buffer for the contents shown since
+  void resizeContents()
+  {
+    bool resized = false;
+    for (auto& [key, t] : _contents)
+    {
+      if (!t.resized || !texturesOutdated(t))
+      {
+        continue;
+      }
+      if (!resized)
+      {
+        // the textures and the staging buffer may be in use by frames in flight
+        _device->waitIdle();
+        resized = true;
+      }
+      const auto [w, h] = t.content->size();
+      util::println("resize content: {} ({}x{})", key, w, h);
+      for (auto& plane : t.planes)
+      {
+        plane.destroy();
+      }
+      createContentTextures(t);
+    }
+
+    if (!resized && _staging.needsResize(requiredStagingSize() * _frames.size()))
+    {
+      // contents were shown or hidden
+      _device->waitIdle();
+      resized = true;
+    }
+    if (resized)
+    {
+      resizeStaging();
+    }
+  }
+
+  // textures are written on the transfer queue and sampled on the graphics queue
+  std::vector<uint32_t> textureQueueFamilies() const
+  {
+    if (_transferQueueFamilyIndex == _queueFamilyIndex)
+    {
+      return {};
+    }
+    return { _queueFamilyIndex, _transferQueueFamilyIndex };
+  }
+
+  uint32_t textureCount() const
+  {
+    return _slotCount * common::maxPlaneCount;
+  }
+
+  // shows a registered content in a pane. panes keep the key, so a content registered later under it shows up too
+  bool showContent(size_t pane, const std::string& key)
+  {
+    if (pane >= _paneContents.size())
+    {
+      return false;
+    }
+    _paneContents[pane] = key;
+    return true;
+  }
+
+  // suspends the contents no pane shows and resumes the ones shown again.
+  // the decode threads are rebalanced before resuming, so a resumed content opens its codec with its new share when it seeks
+  void updateVisibility(double globalTime)
+  {
+    std::vector<content::Content*> resumed;
+    bool changed = false;
+    for (auto& [key, t] : _contents)
+    {
+      const auto visible = visiblePaneSize(key).has_value();
+      if (!visible && !t.suspended)
+      {
+        t.content->suspend(_releaseHiddenContents);
+        t.suspended = true;
+        changed = true;
+      }
+      else if (visible && t.suspended)
+      {
+        resumed.push_back(t.content.get());
+        t.suspended = false;
+      }
+    }
+
+    if (changed || !resumed.empty())
+    {
+      rebalanceDecodeThreads();
+    }
+    for (auto* content : resumed)
+    {
+      content->resume(globalTime);
+    }
+  }
+
+  // splits the decode thread budget across the contents that are shown, weighted by their decode cost
+  void rebalanceDecodeThreads()
+  {
+    std::vector<content::Content*> active;
+    std::vector<double> costs;
+    for (auto& [_, t] : _contents)
+    {
+      const auto cost = t.content->decodeCost();
+      if (!t.suspended && cost > 0)
+      {
+        active.push_back(t.content.get());
+        costs.push_back(cost);
+      }
+    }
+
+    // the scheduler's workers count against the budget: each shown stream keeps about one of them busy with its demux
+    // and convert steps, and its codec threads share the rest
+    const auto workers = std::min(static_cast<uint32_t>(media::DecodeScheduler::shared().threadCount()), static_cast<uint32_t>(costs.size()));
+    const auto threads = util::splitThreadBudget(_decodeThreadBudget > workers ? _decodeThreadBudget - workers : 0, costs);
+    for (size_t i = 0; i < active.size(); i++)
+    {
+      active[i]->setDecodeThreads(threads[i]);
+    }
+  }
+
+  // size in pixels of the largest pane showing the content. nullopt when no pane shows it
+  std::optional<util::float2> visiblePaneSize(const std::string& key) const
+  {
+    std::optional<util::float2> size;
+    for (size_t i = 0; i < _paneContents.size(); i++)
+    {
+      if (_paneContents[i] != key)
+      {
+        continue;
+      }
+      const auto viewport = _viewports.get(i, _swapchainExtent).viewport;
+      if (viewport.width <= 0 || viewport.height <= 0)
+      {
+        continue;
+      }
+      if (!size || viewport.width * viewport.height > (*size)[0] * (*size)[1])
+      {
+        size = util::float2{ viewport.width, viewport.height };
+      }
+    }
+    return size;
+  }
+
+  // hidden and suspended contents do not upload, so only the shown ones take room
+  vk::DeviceSize requiredStagingSize() const
+  {
+    vk::DeviceSize size = 0;
+    for (const auto& [key, t] : _contents)
+    {
+      if (!t.suspended && visiblePaneSize(key))
+      {
+        size += _staging.align(t.layout.size);
+      }
+    }
+    return size;
+  }
+
+  void unregisterContent(std::string key)
+  {
+    if (auto it = _openingContents.find(key); it != _openingContents.end())
+    {
+      it->second->destroy();
+      _openingContents.erase(it);
+    }
+    if (auto it = _contents.find(key); it != _contents.end())
+    {
+      util::println("unregister content: {}", key);
+      _device->waitIdle();
+      it->second.content->destroy();
+      for (auto& plane : it->second.planes)
+      {
+        plane.destroy();
+      }
+      _freeSlots.push_back(it->second.slot);
+      _contents.erase(it);
+      resizeStaging();
+      rebalanceDecodeThreads();
+    }
+  }
+
+  void unregisterAllContents()
+  {
+    for (auto& [_, content] : _openingContents)
+    {
+      content->destroy();
+    }
+    _openingContents.clear();
+
+    util::println("clear contents: ({})", _contents.size());
+    if (_device)
+    {
+      _device->waitIdle();
+    }
+    for (auto& [_, t] : _contents)
+    {
+      t.content->destroy();
+      for (auto& plane : t.planes)
+      {
+        plane.destroy();
+      }
+      _freeSlots.push_back(t.slot);
+    }
+    _contents.clear();
+  }
+
+  void destroy()
+  {
+    if (!_instance)
+      return;
+
+    if (_device)
+      _device->waitIdle();
+
+    // Reset device-owned resources
+    unregisterAllContents();
+    _staging.destroy();
+    _mappedPanes = nullptr;
+    _paneMemory.reset();
+    _paneBuffer.reset();
+    _frameBuffers.clear();
+    _pipeline.reset();
+    _pipelineCache.destroy();
+    _pipelineLayout.reset();
+    _renderPass.reset();
+    _vertShaderModule.reset();
+    _fragShaderModule.reset();
+    _renderFinishedSemaphores.clear();
+    _uploadTimeline.reset();
+    _renderTimeline.reset();
+    _queryPool.reset();
+    _mappedCapture = nullptr;
+    _captureMemory.reset();
+    _captureBuffer.reset();
+    _swapchainImageViews.clear();
+    _swapchainImages.clear();
+    _swapchain.reset();
+    _offscreenImages.clear();
+    _offscreenMemories.clear();
+    _descriptorPool.reset();
+    _descriptorSetLayout.reset();
+    _frames.clear();
+    _transferCommandPool.reset();
+    _commandPool.reset();
+    _device.reset();
+
+    // Manually managed instance-owned resources
+    _instance->destroySurfaceKHR(_surface);
+    _surface = nullptr;
+    DestroyDebugUtilsMessengerEXT(*_instance, _debugMessenger, nullptr);
+    _debugMessenger = {};
+    _instance.reset();
+  }
+
+private:
+  vk::UniqueInstance _instance;
+  VkDebugUtilsMessengerEXT _debugMessenger = {};
+  vk::SurfaceKHR _surface;
+  vk::PhysicalDevice _physicalDevice;
+
+  vk::UniqueDevice _device;
+
+  uint32_t _queueFamilyIndex = 0;
+  vk::Queue _graphicsQueue;
+
+  uint32_t _transferQueueFamilyIndex = 0;
+  uint32_t _transferQueueIndex = 0;
+  vk::Queue _transferQueue;
+  vk::UniqueCommandPool _transferCommandPool;
+
+  vk::UniqueCommandPool _commandPool;
+  std::vector<Frame> _frames;
+  size_t _frameIndex = 0;
+
+  bool _headless = false;
+  vk::UniqueSwapchainKHR _swapchain;
+  std::vector<vk::UniqueImage> _offscreenImages;
+  std::vector<vk::UniqueDeviceMemory> _offscreenMemories;
+  vk::Format _colorFormat = {};
+  vk::Extent2D _swapchainExtent = {};
+  std::vector<vk::Image> _swapchainImages;
+  std::vector<vk::UniqueImageView> _swapchainImageViews;
+  std::vector<vk::UniqueFramebuffer> _frameBuffers;
+
+  ViewportSet _viewports;
+
+  std::vector<vk::UniqueSemaphore> _renderFinishedSemaphores;
+  vk::UniqueSemaphore _uploadTimeline;
+  vk::UniqueSemaphore _renderTimeline;
+  uint64_t _uploadValue = 0;
+  uint64_t _renderValue = 0;
+
+  vk::UniqueDescriptorSetLayout _descriptorSetLayout;
+  vk::UniqueDescriptorPool _descriptorPool;
+  std::vector<vk::DescriptorSet> _descriptorSets;
+
+  vk::UniquePipelineLayout _pipelineLayout;
+  vk::UniquePipeline _pipeline;
+  PipelineCache _pipelineCache;
+
+  vk::UniqueRenderPass _renderPass;
+
+  vk::UniqueShaderModule _vertShaderModule;
+  vk::UniqueShaderModule _fragShaderModule;
+
+  vk::UniqueBuffer _paneBuffer;
+  vk::UniqueDeviceMemory _paneMemory;
+  PaneData* _mappedPanes = nullptr;
+  uint32_t _paneCapacity = 0;
+
+  static constexpr uint32_t queriesPerFrame = 4;
+  vk::UniqueQueryPool _queryPool;
+  uint64_t _graphicsTimestampMask = 0; // 0 when the queue does not support timestamps
+  uint64_t _transferTimestampMask = 0;
+  float _timestampPeriod = 1;
+  uint64_t _frameCounter = 0;
+  FrameStats _stats;
+
+  vk::UniqueBuffer _captureBuffer;
+  vk::UniqueDeviceMemory _captureMemory;
+  const uint8_t* _mappedCapture = nullptr;
+  bool _captureRequested = false;
+  bool _captured = false;
+  size_t _captureFrame = 0;
+
+  std::unordered_map<std::string, WrappedContent> _contents;
+  std::unordered_map<std::string, std::shared_ptr<content::Content>> _openingContents; // registered, not ready yet
+
+  StagingRing _staging;
+  std::vector<vk::ImageMemoryBarrier> _toTransferBarriers;
+  std::vector<UploadCopy> _uploadCopies;
+  std::vector<vk::ImageMemoryBarrier> _toShaderBarriers;
+  std::vector<const common::Texture*> _mipmapTextures; // uploaded in this update, their mip chains are rebuilt
+  std::vector<vk::ImageMemoryBarrier> _mipmapBarriers;
+  uint32_t _slotCount = 0;
+  std::vector<uint32_t> _freeSlots;
+  std::vector<std::string> _paneContents; // content key shown in each pane of _viewports. empty for none
+  bool _hashTiles = false;
+  bool _waitForFrames = false;
+  bool _mipmaps = false;
+  bool _releaseHiddenContents = false;
+  uint32_t _decodeThreadBudget = 1;
+};
+
+}}} // namespace daia::player::pipeline
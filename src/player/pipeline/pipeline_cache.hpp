@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <system_error>
+#include <vector>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "../../util/util.hpp"
+
+namespace daia { namespace player { namespace pipeline {
+
+// VkPipelineCache kept in a file between runs.
+// The file is the driver's own cache data. Its header is checked against the device before the data is handed back,
+// so a cache written by another GPU or driver version is dropped instead of being trusted.
+class PipelineCache
+{
+public:
+  // an empty path keeps the cache in memory only
+  void setup(const vk::UniqueDevice& device, const vk::PhysicalDevice& physicalDevice, const std::filesystem::path& path)
+  {
+    _path = path;
+    const auto data = _path.empty() ? std::vector<uint8_t>() : _load(physicalDevice.getProperties());
+    _loadedSize = data.size();
+    _cache = device->createPipelineCacheUnique({
+      .initialDataSize = data.size(),
+      .pInitialData = data.data(),
+    });
+  }
+
+  // writes the cache if pipelines were added to it since it was loaded
+  void save(const vk::UniqueDevice& device)
+  {
+    if (!_cache || _path.empty())
+    {
+      return;
+    }
+
+    const auto data = device->getPipelineCacheData(*_cache);
+    if (data.size() == _loadedSize)
+    {
+      return;
+    }
+
+    // replace the file in one step so a concurrent instance never reads half of it.
+    // every writer has its own temporary file, so instances saving at the same time do not write into one file
+    std::error_code error;
+    std::filesystem::create_directories(_path.parent_path(), error);
+    auto temporary = _path;
+    std::random_device random;
+    const auto suffix = (uint64_t(random()) << 32) | random();
+    temporary += util::format(".{:016x}.tmp", suffix);
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(data.data()), data.size());
+      if (!file)
+      {
+        file.close();
+        std::filesystem::remove(temporary, error);
+        util::println("failed to write pipeline cache {}", _path.string());
+        return;
+      }
+    }
+    std::filesystem::rename(temporary, _path, error);
+    if (error)
+    {
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+    _loadedSize = data.size();
+  }
+
+  vk::PipelineCache get() const
+  {
+    return *_cache;
+  }
+
+  void destroy()
+  {
+    _cache.reset();
+  }
+
+private:
+  // VkPipelineCacheHeaderVersionOne
+  struct Header
+  {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  };
+
+  std::vector<uint8_t> _load(const vk::PhysicalDeviceProperties& properties) const
+  {
+    std::ifstream file(_path, std::ios::binary);
+    if (!file.is_open())
+    {
+      return {};
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Header header;
+    if (data.size() < sizeof(header))
+    {
+      return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header)
+        || header.headerVersion != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne)
+        || header.vendorID != properties.vendorID
+        || header.deviceID != properties.deviceID
+        || std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+    {
+      util::println("pipeline cache {} belongs to another device or driver, rebuilding it", _path.string());
+      return {};
+    }
+    return data;
+  }
+
+  std::filesystem::path _path;
+  vk::UniquePipelineCache _cache;
+  size_t _loadedSize = 0;
+};
+
+}}} // namespace daia::player::pipeline
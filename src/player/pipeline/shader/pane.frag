@@ -1,22 +1,93 @@
-#version 450
-
-layout(location = 0) in vec4 position;
-layout(location = 0) out vec4 outColor;
-
-layout(set = 0, binding = 0) uniform BlankUbo
-{
-  vec4 colors[8];
-} background;
-
-layout(set = 0, binding = 1) uniform sampler2D tex;
-
-layout(push_constant) uniform PushConstant
-{
-  uint viewportIndex;
-} pushConstant;
-
-void main()
-{
-  // outColor = background.colors[pushConstant.viewportIndex];
-  outColor = texture(tex, position.xy * 0.5 + 0.5);
-}
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec4 position;
+layout(location = 1) flat in uint paneIndex;
+layout(location = 0) out vec4 outColor;
+
+// pipeline::PaneData
+struct Pane
+{
+  vec4 rect;
+  vec4 color;
+  uint textureIndex;
+  uint pixelFormat;
+  uint colorMatrix;
+  uint fullRange;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Panes
+{
+  Pane panes[];
+};
+
+// planes of every registered content, starting at textures[Pane.textureIndex]. RGBA uses the first plane only
+layout(set = 0, binding = 1) uniform sampler2D textures[];
+
+const uint NO_TEXTURE = 0xffffffff;
+
+// common::PixelFormat
+const uint PIXEL_FORMAT_RGBA8 = 0;
+const uint PIXEL_FORMAT_YUV420P = 1;
+const uint PIXEL_FORMAT_NV12 = 2;
+
+// common::ColorMatrix
+const uint COLOR_MATRIX_BT601 = 0;
+const uint COLOR_MATRIX_BT709 = 1;
+
+vec3 yuvToRgb(vec3 yuv, Pane pane)
+{
+  float y = yuv.x;
+  vec2 uv = yuv.yz - 0.5;
+  if (pane.fullRange == 0)
+  {
+    y = (y - 16.0 / 255.0) * (255.0 / 219.0);
+    uv *= 255.0 / 224.0;
+  }
+
+  // Kr, Kb
+  vec2 k = pane.colorMatrix == COLOR_MATRIX_BT601 ? vec2(0.299, 0.114) : vec2(0.2126, 0.0722);
+  float kg = 1.0 - k.x - k.y;
+
+  float r = y + 2.0 * (1.0 - k.x) * uv.y;
+  float b = y + 2.0 * (1.0 - k.y) * uv.x;
+  float g = (y - k.x * r - k.y * b) / kg;
+  return clamp(vec3(r, g, b), 0.0, 1.0);
+}
+
+// panes of one draw show different contents, so the index is not uniform
+vec4 samplePlane(Pane pane, uint plane, vec2 uv)
+{
+  return texture(textures[nonuniformEXT(pane.textureIndex + plane)], uv);
+}
+
+void main()
+{
+  Pane pane = panes[paneIndex];
+  if (pane.textureIndex == NO_TEXTURE)
+  {
+    outColor = pane.color;
+    return;
+  }
+
+  vec2 uv = position.xy * 0.5 + 0.5;
+
+  if (pane.pixelFormat == PIXEL_FORMAT_RGBA8)
+  {
+    outColor = samplePlane(pane, 0, uv);
+    return;
+  }
+
+  vec3 yuv;
+  yuv.x = samplePlane(pane, 0, uv).r;
+  if (pane.pixelFormat == PIXEL_FORMAT_NV12)
+  {
+    yuv.yz = samplePlane(pane, 1, uv).rg;
+  }
+  else
+  {
+    yuv.y = samplePlane(pane, 1, uv).r;
+    yuv.z = samplePlane(pane, 2, uv).r;
+  }
+  outColor = vec4(yuvToRgb(yuv, pane), 1.0);
+}
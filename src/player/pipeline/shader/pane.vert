@@ -1,21 +1,44 @@
-#version 450
-
-vec3 positions[] = vec3[](
-    vec3(-1, 1, 0.1),
-    vec3(-1, -1, 0.1),
-    vec3(1, 1, 0.1),
-    vec3(1, 1, 0.1),
-    vec3(-1, -1, 0.1),
-    vec3(1, -1, 0.1),
-
-    vec3(0.0, -0.5, 0.5),
-    vec3(0.5, 0.5, 0.5),
-    vec3(-0.5, 0., 0.5)
-);
-
-layout(location = 0) out vec4 position;
-
-void main() {
-    position = vec4(positions[gl_VertexIndex], 1);
-    gl_Position = position;
-}
+#version 450
+
+vec3 positions[] = vec3[](
+    vec3(-1, 1, 0.1),
+    vec3(-1, -1, 0.1),
+    vec3(1, 1, 0.1),
+    vec3(1, 1, 0.1),
+    vec3(-1, -1, 0.1),
+    vec3(1, -1, 0.1),
+
+    vec3(0.0, -0.5, 0.5),
+    vec3(0.5, 0.5, 0.5),
+    vec3(-0.5, 0., 0.5)
+);
+
+// pipeline::PaneData
+struct Pane
+{
+    vec4 rect;
+    vec4 color;
+    uint textureIndex;
+    uint pixelFormat;
+    uint colorMatrix;
+    uint fullRange;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Panes
+{
+    Pane panes[];
+};
+
+layout(location = 0) out vec4 position;
+layout(location = 1) flat out uint paneIndex;
+
+void main() {
+    // one instance per pane. firstInstance selects the pane array of the frame
+    vec4 rect = panes[gl_InstanceIndex].rect;
+    position = vec4(positions[gl_VertexIndex], 1);
+    paneIndex = gl_InstanceIndex;
+
+    // pane-local [-1, 1] to the pane rectangle in framebuffer space
+    vec2 uv = position.xy * 0.5 + 0.5;
+    gl_Position = vec4((rect.xy + uv * rect.zw) * 2.0 - 1.0, position.zw);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+namespace daia { namespace player { namespace pipeline { namespace shader {
+
+// SPIR-V of the shaders in this directory, generated by the compile_shaders target
+
+inline constexpr uint32_t paneVert[] = {
+#include "pipeline/shader/pane.vert.inc"
+};
+
+inline constexpr uint32_t paneFrag[] = {
+#include "pipeline/shader/pane.frag.inc"
+};
+
+}}}} // namespace daia::player::pipeline::shader
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "../common/util.hpp"
+
+namespace daia { namespace player { namespace pipeline {
+
+// Persistently mapped, host coherent upload buffer used as a ring.
+// Positions grow monotonically; an allocation never straddles the end of the buffer.
+// Work recorded with allocations up to mark() is released with release(mark) once the GPU is done with it.
+class StagingRing
+{
+public:
+  struct Allocation
+  {
+    vk::DeviceSize offset;
+    uint8_t* data;
+  };
+
+  static constexpr vk::DeviceSize shrinkRatio = 2;
+
+  void setup(const vk::UniqueDevice& device, const vk::PhysicalDevice& physicalDevice, vk::DeviceSize capacity)
+  {
+    const auto limits = physicalDevice.getProperties().limits;
+    _alignment = std::max<vk::DeviceSize>(4, limits.optimalBufferCopyOffsetAlignment);
+
+    _mapped = nullptr;
+    _memory.reset();
+    _buffer.reset();
+
+    _capacity = align(std::max<vk::DeviceSize>(capacity, _alignment));
+    _buffer = device->createBufferUnique({
+      .size = _capacity,
+      .usage = vk::BufferUsageFlagBits::eTransferSrc,
+      .sharingMode = vk::SharingMode::eExclusive,
+    });
+
+    // cached memory when there is one: tile hashing reads the frames back, which is very slow on write-combined memory
+    const auto memReqs = device->getBufferMemoryRequirements(*_buffer);
+    const auto hostMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    const auto cachedMemory = hostMemory | vk::MemoryPropertyFlagBits::eHostCached;
+    _memory = device->allocateMemoryUnique({
+      .allocationSize = memReqs.size,
+      .memoryTypeIndex = common::findMemoryType(
+        physicalDevice,
+        memReqs.memoryTypeBits,
+        common::hasMemoryType(physicalDevice, memReqs.memoryTypeBits, cachedMemory) ? cachedMemory : hostMemory),
+    });
+    device->bindBufferMemory(*_buffer, *_memory, 0);
+    _mapped = static_cast<uint8_t*>(device->mapMemory(*_memory, 0, _capacity));
+
+    // positions keep growing so marks taken before a resize are simply stale
+    _head = align(_head);
+    _tail = _head;
+  }
+
+  // capacity does not fit the buffer: it is larger, or less than half of it
+  bool needsResize(vk::DeviceSize capacity) const
+  {
+    return capacity > _capacity || align(std::max<vk::DeviceSize>(capacity, _alignment)) * shrinkRatio < _capacity;
+  }
+
+  // grows the buffer to capacity, or shrinks it when it holds more than twice that. call while the device is idle
+  void resize(const vk::UniqueDevice& device, const vk::PhysicalDevice& physicalDevice, vk::DeviceSize capacity)
+  {
+    if (needsResize(capacity))
+    {
+      setup(device, physicalDevice, capacity);
+    }
+  }
+
+  std::optional<Allocation> allocate(vk::DeviceSize size)
+  {
+    auto head = align(_head);
+    if (head % _capacity + size > _capacity)
+    {
+      // skip the rest of the buffer and start over from offset 0
+      head += _capacity - head % _capacity;
+    }
+    if (head + size - _tail > _capacity)
+    {
+      return std::nullopt;
+    }
+
+    const auto offset = head % _capacity;
+    _head = head + size;
+    return Allocation{ .offset = offset, .data = _mapped + offset };
+  }
+
+  vk::DeviceSize mark() const
+  {
+    return _head;
+  }
+
+  void release(vk::DeviceSize mark)
+  {
+    _tail = std::max(_tail, mark);
+  }
+
+  bool idle() const
+  {
+    return _head == _tail;
+  }
+
+  vk::DeviceSize capacity() const
+  {
+    return _capacity;
+  }
+
+  vk::DeviceSize align(vk::DeviceSize size) const
+  {
+    return (size + _alignment - 1) / _alignment * _alignment;
+  }
+
+  const vk::Buffer buffer() const
+  {
+    return *_buffer;
+  }
+
+  void destroy()
+  {
+    _mapped = nullptr;
+    _memory.reset();
+    _buffer.reset();
+    _capacity = 0;
+    _head = 0;
+    _tail = 0;
+  }
+
+private:
+  vk::UniqueBuffer _buffer;
+  vk::UniqueDeviceMemory _memory;
+  uint8_t* _mapped = nullptr;
+  vk::DeviceSize _capacity = 0;
+  vk::DeviceSize _alignment = 4;
+  vk::DeviceSize _head = 0;
+  vk::DeviceSize _tail = 0;
+};
+
+}}} // namespace daia::player::pipeline
@@ -1,91 +1,95 @@
-#pragma once
-
-#include <cstdint>
-#include <vector>
-
-#define VULKAN_HPP_NO_CONSTRUCTORS
-#include <vulkan/vulkan.hpp>
-
-#include "../../util/util.hpp"
-
-namespace daia { namespace player { namespace pipeline {
-
-struct PushConstant
-{
-  uint32_t viewportIndex;
-};
-
-struct ViewportSource
-{
-  float x;
-  float y;
-  float width;
-  float height;
-  util::float4 color;
-};
-
-class ViewportSet
-{
-public:
-  struct BlankUboData
-  {
-    util::float4 colors[8];
-  };
-
-  struct Viewport
-  {
-    vk::Viewport viewport;
-    vk::Rect2D scissor;
-  };
-
-  const size_t add(const ViewportSource& source)
-  {
-    size_t index = sources.size();
-    sources.emplace_back(source);
-    return index;
-  }
-
-  const Viewport get(const size_t i, const vk::Extent2D& screenExtent) const
-  {
-    return {
-      .viewport = vk::Viewport{
-        .x = screenExtent.width * sources[i].x,
-        .y = screenExtent.height * sources[i].y,
-        .width = screenExtent.width * sources[i].width,
-        .height = screenExtent.height * sources[i].height,
-        .minDepth = 0,
-        .maxDepth = 1,
-      },
-      .scissor = {
-        .offset = {
-          .x = static_cast<int>(screenExtent.width * sources[i].x),
-          .y = static_cast<int>(screenExtent.height * sources[i].y),
-        },
-        .extent = {
-          static_cast<uint32_t>(screenExtent.width * sources[i].width),
-          static_cast<uint32_t>(screenExtent.height * sources[i].height),
-        },
-      }
-    };
-  }
-
-  const size_t size() const
-  {
-    return sources.size();
-  }
-
-  const BlankUboData getBlankUboData() const
-  {
-    BlankUboData data;
-    for (int i = 0; i < sources.size(); i++)
-    {
-      data.colors[i] = sources[i].color;
-    }
-    return data;
-  }
-
-private:
-  std::vector<ViewportSource> sources;
-};
-
-}}} // namespace daia::player::pipeline
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define VULKAN_HPP_NO_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include "../../util/util.hpp"
+
+namespace daia { namespace player { namespace pipeline {
+
+// textureIndex of a pane without content
+inline constexpr uint32_t noTexture = ~0u;
+
+// one element of the pane storage buffer. std430 layout, matches Pane in pane.vert and pane.frag
+struct PaneData
+{
+  util::float4 rect;     // x, y, width, height as fractions of the framebuffer
+  util::float4 color;    // drawn when there is no texture
+  uint32_t textureIndex; // first plane of the content in the texture array, or noTexture
+  uint32_t pixelFormat;  // common::PixelFormat
+  uint32_t colorMatrix;  // common::ColorMatrix
+  uint32_t fullRange;
+};
+
+struct ViewportSource
+{
+  float x;
+  float y;
+  float width;
+  float height;
+  util::float4 color;
+};
+
+class ViewportSet
+{
+public:
+  struct Viewport
+  {
+    vk::Viewport viewport;
+    vk::Rect2D scissor;
+  };
+
+  const size_t add(const ViewportSource& source)
+  {
+    size_t index = sources.size();
+    sources.emplace_back(source);
+    return index;
+  }
+
+  const Viewport get(const size_t i, const vk::Extent2D& screenExtent) const
+  {
+    return {
+      .viewport = vk::Viewport{
+        .x = screenExtent.width * sources[i].x,
+        .y = screenExtent.height * sources[i].y,
+        .width = screenExtent.width * sources[i].width,
+        .height = screenExtent.height * sources[i].height,
+        .minDepth = 0,
+        .maxDepth = 1,
+      },
+      .scissor = {
+        .offset = {
+          .x = static_cast<int>(screenExtent.width * sources[i].x),
+          .y = static_cast<int>(screenExtent.height * sources[i].y),
+        },
+        .extent = {
+          static_cast<uint32_t>(screenExtent.width * sources[i].width),
+          static_cast<uint32_t>(screenExtent.height * sources[i].height),
+        },
+      }
+    };
+  }
+
+  const size_t size() const
+  {
+    return sources.size();
+  }
+
+  // placement and background of pane i. the content fields are left to the caller
+  const PaneData getPaneData(const size_t i) const
+  {
+    return {
+      .rect = { sources[i].x, sources[i].y, sources[i].width, sources[i].height },
+      .color = sources[i].color,
+      .textureIndex = noTexture,
+    };
+  }
+
+private:
+  std::vector<ViewportSource> sources;
+};
+
+}}} // namespace daia::player::pipeline
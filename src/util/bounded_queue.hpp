@@ -0,0 +1,134 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace daia { namespace util {
+
+// Fixed capacity FIFO shared between threads.
+// push() blocks while full and pop() blocks while empty. close() wakes every waiter;
+// after that push() fails and pop() drains the remaining items.
+template <typename T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(size_t capacity)
+    : _items(capacity)
+  {
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  bool push(T value)
+  {
+    std::unique_lock lock(_mutex);
+    _notFull.wait(lock, [this] { return _closed || _count < _items.size(); });
+    if (_closed)
+    {
+      return false;
+    }
+    _items[(_head + _count) % _items.size()] = std::move(value);
+    _count++;
+    _notEmpty.notify_one();
+    return true;
+  }
+
+  std::optional<T> pop()
+  {
+    std::unique_lock lock(_mutex);
+    _notEmpty.wait(lock, [this] { return _closed || _count > 0; });
+    return _popLocked();
+  }
+
+  std::optional<T> tryPop()
+  {
+    std::lock_guard lock(_mutex);
+    return _popLocked();
+  }
+
+  void close()
+  {
+    std::lock_guard lock(_mutex);
+    _closed = true;
+    _notFull.notify_all();
+    _notEmpty.notify_all();
+  }
+
+  // drop all items
+  void clear()
+  {
+    std::lock_guard lock(_mutex);
+    _clearLocked();
+  }
+
+  // drop all items and accept pushes again
+  void reopen()
+  {
+    std::lock_guard lock(_mutex);
+    _clearLocked();
+    _closed = false;
+  }
+
+  bool closed() const
+  {
+    std::lock_guard lock(_mutex);
+    return _closed;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard lock(_mutex);
+    return _count;
+  }
+
+  bool full() const
+  {
+    std::lock_guard lock(_mutex);
+    return _count == _items.size();
+  }
+
+  size_t capacity() const
+  {
+    return _items.size();
+  }
+
+private:
+  void _clearLocked()
+  {
+    for (auto& item : _items)
+    {
+      item.reset();
+    }
+    _head = 0;
+    _count = 0;
+    _notFull.notify_all();
+  }
+
+  std::optional<T> _popLocked()
+  {
+    if (_count == 0)
+    {
+      return std::nullopt;
+    }
+    auto value = std::move(_items[_head]);
+    _items[_head].reset();
+    _head = (_head + 1) % _items.size();
+    _count--;
+    _notFull.notify_one();
+    return value;
+  }
+
+  mutable std::mutex _mutex;
+  std::condition_variable _notFull;
+  std::condition_variable _notEmpty;
+  std::vector<std::optional<T>> _items;
+  size_t _head = 0;
+  size_t _count = 0;
+  bool _closed = false;
+};
+
+}} // namespace daia::util
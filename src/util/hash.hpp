@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace daia { namespace util {
+
+// Fast non-cryptographic hash for change detection. chain calls by passing the previous result as seed
+inline uint64_t hashBytes(const uint8_t* data, size_t size, uint64_t seed = 0)
+{
+  constexpr uint64_t k = 0x9e3779b97f4a7c15ull;
+
+  auto h = seed ^ (size * k);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    h = (h ^ word) * k;
+    h ^= h >> 29;
+  }
+
+  uint64_t tail = 0;
+  std::memcpy(&tail, data + i, size - i);
+  h = (h ^ tail) * k;
+  return h ^ (h >> 32);
+}
+
+}} // namespace daia::util
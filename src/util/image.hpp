@@ -1,74 +1,102 @@
-#pragma once
-
-#include <cstdint>
-#include <cwchar>
-#include <filesystem>
-#include <tuple>
-#include <vector>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-namespace daia { namespace util {
-
-class Image
-{
-private:
-  uint32_t _width;
-  uint32_t _height;
-  std::vector<uint8_t> _pixels;
-
-public:
-  const std::tuple<const uint32_t&, const uint32_t&> size() const
-  {
-    return std::make_tuple(_width, _height);
-  }
-
-  const uint32_t& width() const
-  {
-    return _width;
-  }
-
-  const uint32_t& height() const
-  {
-    return _height;
-  }
-
-  const size_t length() const
-  {
-    return _pixels.size();
-  }
-
-  const uint8_t* data() const
-  {
-    return _pixels.data();
-  }
-
-  std::vector<uint8_t>& pixels()
-  {
-    return _pixels;
-  }
-
-  void load(const std::filesystem::path& path)
-  {
-    int w, h;
-    int ch = 4;
-    uint8_t* pixels = stbi_load(path.string().c_str(), &w, &h, nullptr, ch);
-
-    _width = w;
-    _height = h;
-    _pixels.resize(w * h * ch);
-    memcpy(_pixels.data(), pixels, w * h * 4);
-
-    stbi_image_free(pixels);
-  }
-};
-
-Image fromFile(const std::filesystem::path& path)
-{
-  auto ret = Image();
-  ret.load(path);
-  return ret;
-}
-
-}} // namespace daia::util
+#pragma once
+
+#include <cstdint>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace daia { namespace util {
+
+class Image
+{
+private:
+  uint32_t _width;
+  uint32_t _height;
+  std::vector<uint8_t> _pixels;
+
+public:
+  Image() = default;
+
+  // pixels are RGBA
+  Image(uint32_t width, uint32_t height, std::vector<uint8_t> pixels)
+    : _width(width)
+    , _height(height)
+    , _pixels(std::move(pixels))
+  {
+  }
+
+  const std::tuple<const uint32_t&, const uint32_t&> size() const
+  {
+    return std::make_tuple(_width, _height);
+  }
+
+  const uint32_t& width() const
+  {
+    return _width;
+  }
+
+  const uint32_t& height() const
+  {
+    return _height;
+  }
+
+  const size_t length() const
+  {
+    return _pixels.size();
+  }
+
+  const uint8_t* data() const
+  {
+    return _pixels.data();
+  }
+
+  std::vector<uint8_t>& pixels()
+  {
+    return _pixels;
+  }
+
+  void load(const std::filesystem::path& path)
+  {
+    int w, h;
+    int ch = 4;
+    uint8_t* pixels = stbi_load(path.string().c_str(), &w, &h, nullptr, ch);
+
+    _width = w;
+    _height = h;
+    _pixels.resize(w * h * ch);
+    memcpy(_pixels.data(), pixels, w * h * 4);
+
+    stbi_image_free(pixels);
+  }
+
+  // binary PPM. alpha is dropped
+  bool savePpm(const std::filesystem::path& path) const
+  {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+      return false;
+    }
+    file << "P6\n"
+         << _width << " " << _height << "\n255\n";
+    for (size_t i = 0; i < _pixels.size(); i += 4)
+    {
+      file.write(reinterpret_cast<const char*>(&_pixels[i]), 3);
+    }
+    return file.good();
+  }
+};
+
+Image fromFile(const std::filesystem::path& path)
+{
+  auto ret = Image();
+  ret.load(path);
+  return ret;
+}
+
+}} // namespace daia::util
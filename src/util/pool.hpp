@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace daia { namespace util {
+
+// Free list of reusable objects shared between threads.
+// Storage is reserved up front, so acquire/release never allocate for the pool itself.
+template <typename T>
+class Pool
+{
+public:
+  explicit Pool(size_t capacity)
+  {
+    _items.reserve(capacity);
+  }
+
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  // takes a recycled object, or creates one with make() when the pool is empty
+  template <typename Make>
+  T acquire(Make&& make)
+  {
+    {
+      std::lock_guard lock(_mutex);
+      if (!_items.empty())
+      {
+        T value = std::move(_items.back());
+        _items.pop_back();
+        return value;
+      }
+    }
+    return make();
+  }
+
+  // returns an object to the pool. dropped if the pool is full
+  void release(T value)
+  {
+    std::lock_guard lock(_mutex);
+    if (_items.size() < _items.capacity())
+    {
+      _items.push_back(std::move(value));
+    }
+  }
+
+  void clear()
+  {
+    std::lock_guard lock(_mutex);
+    _items.clear();
+  }
+
+private:
+  std::mutex _mutex;
+  std::vector<T> _items;
+};
+
+}} // namespace daia::util
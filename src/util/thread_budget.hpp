@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace daia { namespace util {
+
+// Splits budget threads across consumers in proportion to their costs.
+// Every consumer gets at least one thread, even past the budget, and at most maxPerConsumer.
+// The threads left over by rounding go to the largest remainders.
+inline std::vector<uint32_t> splitThreadBudget(uint32_t budget, std::span<const double> costs, uint32_t maxPerConsumer = 16)
+{
+  const auto count = costs.size();
+  std::vector<uint32_t> threads(count, 1);
+  if (count == 0 || budget <= count)
+  {
+    return threads;
+  }
+
+  const auto spare = budget - static_cast<uint32_t>(count);
+  const auto total = std::accumulate(costs.begin(), costs.end(), 0.0);
+
+  std::vector<double> remainders(count);
+  uint32_t assigned = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const auto share = total > 0 ? spare * costs[i] / total : double(spare) / count;
+    const auto whole = static_cast<uint32_t>(std::floor(share));
+    threads[i] += whole;
+    remainders[i] = share - whole;
+    assigned += whole;
+  }
+
+  std::vector<size_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&remainders](size_t a, size_t b) { return remainders[a] > remainders[b]; });
+  for (size_t i = 0; i < count && assigned < spare; i++, assigned++)
+  {
+    threads[order[i]]++;
+  }
+
+  for (auto& t : threads)
+  {
+    t = std::min(t, maxPerConsumer);
+  }
+  return threads;
+}
+
+// whether a consumer holding current threads should switch to target. changes below half of the smaller count are
+// ignored, so shares that shift by a thread whenever another consumer comes or goes do not restart the work
+inline bool threadShareChanged(uint32_t current, uint32_t target)
+{
+  return std::max(current, target) * 2 >= std::min(current, target) * 3;
+}
+
+}} // namespace daia::util
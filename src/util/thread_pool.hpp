@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace daia { namespace util {
+
+// Fixed set of worker threads running submitted tasks in FIFO order.
+// stop() drops the tasks that have not started and joins the workers after their current task; tasks submitted after
+// it are refused. A task may come with a dropped callback, called outside the pool's lock instead of the task.
+// Tasks are queued in a ring that only grows, so submitting small tasks does not allocate once it is large enough.
+class ThreadPool
+{
+public:
+  ThreadPool(size_t threadCount, std::string name)
+  {
+    for (size_t i = 0; i < std::max<size_t>(threadCount, 1); i++)
+    {
+      _threads.emplace_back([this, name](std::stop_token stop) {
+        trace::setThreadName(name);
+        _run(stop);
+      });
+    }
+  }
+
+  ~ThreadPool()
+  {
+    stop();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // false when the pool is stopped and the task will never run. dropped is not called then
+  bool submit(std::function<void()> task, std::function<void()> dropped = {})
+  {
+    {
+      std::lock_guard lock(_mutex);
+      if (_stopped)
+      {
+        return false;
+      }
+      if (_count == _tasks.size())
+      {
+        _grow();
+      }
+      _tasks[(_head + _count) % _tasks.size()] = { .run = std::move(task), .dropped = std::move(dropped) };
+      _count++;
+    }
+    _available.notify_one();
+    return true;
+  }
+
+  // blocks until every submitted task has finished
+  void wait()
+  {
+    std::unique_lock lock(_mutex);
+    _idle.wait(lock, [this] { return _count == 0 && _running == 0; });
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard lock(_mutex);
+      _stopped = true;
+    }
+    for (auto& thread : _threads)
+    {
+      thread.request_stop();
+    }
+    for (auto& thread : _threads)
+    {
+      if (thread.joinable())
+      {
+        thread.join();
+      }
+    }
+    std::vector<Task> dropped;
+    {
+      std::lock_guard lock(_mutex);
+      while (_count > 0)
+      {
+        dropped.push_back(_pop());
+      }
+      _idle.notify_all();
+    }
+    for (auto& task : dropped)
+    {
+      if (task.dropped)
+      {
+        task.dropped();
+      }
+    }
+  }
+
+private:
+  struct Task
+  {
+    std::function<void()> run;
+    std::function<void()> dropped;
+  };
+
+  // call with _mutex held
+  Task _pop()
+  {
+    auto task = std::move(_tasks[_head]);
+    _tasks[_head] = {};
+    _head = (_head + 1) % _tasks.size();
+    _count--;
+    return task;
+  }
+
+  // call with _mutex held
+  void _grow()
+  {
+    std::vector<Task> tasks(std::max<size_t>(_tasks.size() * 2, 16));
+    for (size_t i = 0; i < _count; i++)
+    {
+      tasks[i] = std::move(_tasks[(_head + i) % _tasks.size()]);
+    }
+    _tasks.swap(tasks);
+    _head = 0;
+  }
+
+  void _run(std::stop_token stop)
+  {
+    while (true)
+    {
+      Task task;
+      {
+        std::unique_lock lock(_mutex);
+        // a stop request ends the worker even with tasks queued: stop() drops them
+        if (!_available.wait(lock, stop, [this] { return _count > 0; }) || stop.stop_requested())
+        {
+          return;
+        }
+        task = _pop();
+        _running++;
+      }
+      task.run();
+
+      std::lock_guard lock(_mutex);
+      _running--;
+      if (_count == 0 && _running == 0)
+      {
+        _idle.notify_all();
+      }
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable_any _available;
+  std::condition_variable _idle;
+  size_t _running = 0;
+  bool _stopped = false;
+  std::vector<Task> _tasks; // ring of _count tasks from _head
+  size_t _head = 0;
+  size_t _count = 0;
+  std::vector<std::jthread> _threads;
+};
+
+}} // namespace daia::util
@@ -0,0 +1,175 @@
+#pragma once
+
+// Chrome trace_event recorder. Open the written JSON in chrome://tracing or https://ui.perfetto.dev.
+// Compiled in only with DAIA_TRACE defined (cmake -DDAIA_ENABLE_TRACE=ON); otherwise the macros expand to nothing
+// and write() does nothing.
+// Every thread appends complete events to its own buffer, so recording takes one uncontended lock.
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace daia { namespace util { namespace trace {
+
+#ifdef DAIA_TRACE
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+struct Event
+{
+  const char* name; // string literal
+  int64_t begin;    // microseconds since start
+  int64_t duration;
+};
+
+class ThreadBuffer
+{
+public:
+  explicit ThreadBuffer(uint32_t tid)
+    : tid(tid)
+  {
+    events.reserve(1 << 16);
+  }
+
+  const uint32_t tid;
+  std::string name;
+  std::mutex mutex; // only contended while write() runs
+  std::vector<Event> events;
+};
+
+class Recorder
+{
+public:
+  static Recorder& instance()
+  {
+    static Recorder recorder;
+    return recorder;
+  }
+
+  int64_t now() const
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+  }
+
+  ThreadBuffer& threadBuffer()
+  {
+    // the registry keeps the buffer alive after its thread exits
+    thread_local std::shared_ptr<ThreadBuffer> buffer = _register();
+    return *buffer;
+  }
+
+  void add(const Event& event)
+  {
+    auto& buffer = threadBuffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.events.push_back(event);
+  }
+
+  bool write(const std::filesystem::path& path)
+  {
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+      return false;
+    }
+
+    std::lock_guard lock(_mutex);
+    file << "{\"traceEvents\":[\n";
+    auto first = true;
+    const auto separator = [&first, &file] {
+      file << (first ? "" : ",\n");
+      first = false;
+    };
+    for (const auto& buffer : _buffers)
+    {
+      std::lock_guard bufferLock(buffer->mutex);
+      if (!buffer->name.empty())
+      {
+        separator();
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+      }
+      for (const auto& event : buffer->events)
+      {
+        separator();
+        file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+             << ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << "}";
+      }
+    }
+    file << "\n]}\n";
+    return file.good();
+  }
+
+private:
+  std::shared_ptr<ThreadBuffer> _register()
+  {
+    std::lock_guard lock(_mutex);
+    _buffers.push_back(std::make_shared<ThreadBuffer>(static_cast<uint32_t>(_buffers.size())));
+    return _buffers.back();
+  }
+
+  const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> _buffers;
+};
+
+// records the lifetime of the scope as one event
+class Scope
+{
+public:
+  explicit Scope(const char* name)
+    : _name(name)
+    , _begin(Recorder::instance().now())
+  {
+  }
+
+  ~Scope()
+  {
+    auto& recorder = Recorder::instance();
+    recorder.add({ .name = _name, .begin = _begin, .duration = recorder.now() - _begin });
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  const char* _name;
+  int64_t _begin;
+};
+
+// names the calling thread in the trace. name must not need JSON escaping
+inline void setThreadName(std::string name)
+{
+  if constexpr (enabled)
+  {
+    auto& buffer = Recorder::instance().threadBuffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.name = std::move(name);
+  }
+}
+
+inline bool write(const std::filesystem::path& path)
+{
+  if constexpr (enabled)
+  {
+    return Recorder::instance().write(path);
+  }
+  return true;
+}
+
+}}} // namespace daia::util::trace
+
+#ifdef DAIA_TRACE
+#define DAIA_TRACE_CONCAT_(a, b) a##b
+#define DAIA_TRACE_CONCAT(a, b) DAIA_TRACE_CONCAT_(a, b)
+// name must be a string literal
+#define DAIA_TRACE_SCOPE(name) const ::daia::util::trace::Scope DAIA_TRACE_CONCAT(_traceScope, __LINE__)(name)
+#else
+#define DAIA_TRACE_SCOPE(name) ((void)0)
+#endif